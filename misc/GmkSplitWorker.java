@@ -0,0 +1,70 @@
+import com.ganggarrison.gmdec.GmkSplitter;
+
+import java.io.BufferedReader;
+import java.io.File;
+import java.io.FileDescriptor;
+import java.io.FileOutputStream;
+import java.io.InputStreamReader;
+import java.io.PrintStream;
+import java.nio.charset.StandardCharsets;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Executors;
+import java.util.concurrent.TimeUnit;
+
+// Keeps gmksplit.jar loaded for a whole batch of GameMakerLegacyHelper. Runs from source (Java 11+):
+//   java -cp gmksplit.jar GmkSplitWorker.java [threads]
+// Jobs come from stdin, one per line: <id>\t<gmk file>\t<output folder>
+// Answers go to stdout: <id>\tOK or <id>\tERROR\t<message>
+// GmkSplitter keeps static state, so jobs run one at a time unless more threads are asked for
+public class GmkSplitWorker
+{
+    public static void main(String[] args) throws Exception
+    {
+        final int threads = args.length > 0 ? Math.max(1, Integer.parseInt(args[0])) : 1;
+
+        final PrintStream answers = new PrintStream(new FileOutputStream(FileDescriptor.out), true, "UTF-8");
+
+        // gmksplit prints its progress, it must not get mixed into the answers
+        System.setOut(System.err);
+
+        final ExecutorService executor = Executors.newFixedThreadPool(threads);
+
+        final BufferedReader jobs = new BufferedReader(new InputStreamReader(System.in, StandardCharsets.UTF_8));
+
+        String line;
+        while ((line = jobs.readLine()) != null)
+        {
+            final String[] parts = line.split("\t", -1);
+            if (parts.length != 3)
+            {
+                answer(answers, parts[0], "ERROR\tBad job");
+                continue;
+            }
+
+            executor.execute(() ->
+            {
+                try
+                {
+                    GmkSplitter.decompose(new File(parts[1]), new File(parts[2]));
+                    answer(answers, parts[0], "OK");
+                }
+                catch (Throwable e)
+                {
+                    answer(answers, parts[0], "ERROR\t" + String.valueOf(e).replace('\t', ' ').replace('\n', ' '));
+                }
+            });
+        }
+
+        executor.shutdown();
+        executor.awaitTermination(Long.MAX_VALUE, TimeUnit.DAYS);
+    }
+
+    private static void answer(PrintStream answers, String id, String result)
+    {
+        synchronized (answers)
+        {
+            answers.print(id + "\t" + result + "\n");
+            answers.flush();
+        }
+    }
+}
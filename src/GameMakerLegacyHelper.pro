@@ -1,25 +1,65 @@
-QT       += core gui xml
+QT       += core gui xml concurrent
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
 CONFIG += c++11
 
+# Batched file reads through io_uring when liburing is installed
+unix:!macx {
+    packagesExist(liburing) {
+        CONFIG += link_pkgconfig
+        PKGCONFIG += liburing
+        DEFINES += GMLH_HAVE_LIBURING
+    }
+}
+
+# GmkSplitWorker.java is run from source by the JVM. Found in misc/ when the program is not installed
+DEFINES += GMLH_MISC_DIR=\\\"$$PWD/../misc\\\"
+
 # You can make your code fail to compile if it uses deprecated APIs.
 # In order to do so, uncomment the following line.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
+    batchconverter.cpp \
+    batchio.cpp \
+    codepool.cpp \
+    dirwalker.cpp \
+    fileutils.cpp \
     gms1corrector.cpp \
     gms2corrector.cpp \
+    gmksplitcache.cpp \
+    gmksplitworker.cpp \
+    iothrottle.cpp \
+    logger.cpp \
+    logmodel.cpp \
     logwindow.cpp \
     main.cpp \
-    mainwindow.cpp
+    mainwindow.cpp \
+    snapshot.cpp \
+    stringpool.cpp \
+    workspace.cpp \
+    yyjson.cpp
 
 HEADERS += \
+    batchconverter.h \
+    batchio.h \
+    codepool.h \
+    dirwalker.h \
+    fileutils.h \
     gms1corrector.h \
     gms2corrector.h \
+    gmksplitcache.h \
+    gmksplitworker.h \
+    iothrottle.h \
+    logger.h \
+    logmodel.h \
     logwindow.h \
-    mainwindow.h
+    mainwindow.h \
+    snapshot.h \
+    stringpool.h \
+    workspace.h \
+    yyjson.h
 
 FORMS += \
     logwindow.ui \
@@ -47,3 +87,9 @@ win32: {
 qnx: target.path = /tmp/$${TARGET}/bin
 else: unix:!android: target.path = /opt/$${TARGET}/bin
 !isEmpty(target.path): INSTALLS += target
+
+!isEmpty(target.path) {
+    gmkSplitWorker.files = $$PWD/../misc/GmkSplitWorker.java
+    gmkSplitWorker.path = $$target.path/GmkSplitter.v0.18
+    INSTALLS += gmkSplitWorker
+}
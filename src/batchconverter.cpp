@@ -0,0 +1,615 @@
+#include "batchconverter.h"
+#include "gms1corrector.h"
+#include "gms2corrector.h"
+#include "iothrottle.h"
+#include "gmksplitcache.h"
+#include "gmksplitworker.h"
+#include "logger.h"
+#include "snapshot.h"
+#include "workspace.h"
+#include <QThreadPool>
+#include <QRunnable>
+#include <QElapsedTimer>
+#include <QAtomicInt>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QFileInfo>
+#include <QFile>
+#include <QDir>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace
+{
+
+class Task : public QRunnable
+{
+public:
+    explicit Task(std::function<void()> function_) : function(std::move(function_)) {}
+    void run() override { function(); }
+
+private:
+    std::function<void()> function;
+};
+
+struct ProjectState
+{
+    BatchConverter::Project project;
+    Workspace workDir;
+    QElapsedTimer timer;
+    QAtomicInt pending;
+    QAtomicInt gms2Pending; // GMK tasks of a GMK to GMS2 project that are not finished yet
+    QAtomicInt tasks;
+    QAtomicInt succeeded;
+    QAtomicInt failed;
+    bool prepared = false;
+    qint64 elapsedMs = 0;
+    QStringList snapshotRoots;
+    QStringList snapshots;
+    CodeStats codeStats; // every resource has its own code pool, only the stats stay with the project
+};
+
+// Enough for examples of every event, the counts do not depend on it
+static const int MaxStoredRecords = 10000;
+static const int ExamplesPerEvent = 3;
+
+// Warnings and errors stored by the logger during the last run, by event
+QJsonArray storedEvents()
+{
+    QJsonArray events;
+
+    for (int i = 0; i < static_cast<int>(Logger::Event::Count); ++i)
+    {
+        const Logger::Event event = static_cast<Logger::Event>(i);
+
+        const int count = Logger::recordCount(event);
+        if (count == 0)
+        {
+            continue;
+        }
+
+        QJsonArray examples;
+        for (const Logger::Record& record : Logger::records(event).mid(0, ExamplesPerEvent))
+        {
+            examples.append(record.toString());
+        }
+
+        QJsonObject object;
+        object.insert("event", Logger::eventName(event));
+        object.insert("count", count);
+        object.insert("examples", examples);
+
+        events.append(object);
+    }
+
+    return events;
+}
+
+QString resolvePath(const QDir& base, const QString& path)
+{
+    if (path.isEmpty())
+    {
+        return path;
+    }
+
+    return QDir::cleanPath(base.absoluteFilePath(path));
+}
+
+}
+
+QVector<BatchConverter::Project> BatchConverter::loadManifest(const QString &fileName, QString &error)
+{
+    QFile file(fileName);
+    if (!file.open(QFile::ReadOnly))
+    {
+        error = QString("Failed to open file \"%1\" for read").arg(fileName);
+        return QVector<Project>();
+    }
+
+    QJsonParseError parseError;
+    const QJsonDocument document = QJsonDocument::fromJson(file.readAll(), &parseError);
+    if (parseError.error != QJsonParseError::NoError)
+    {
+        error = QString("Failed to parse manifest \"%1\": %2").arg(fileName, parseError.errorString());
+        return QVector<Project>();
+    }
+
+    const QDir base = QFileInfo(fileName).absoluteDir();
+
+    QVector<Project> projects;
+
+    const QJsonArray projectsArray = document.object().value("projects").toArray();
+    for (const QJsonValue& value : projectsArray)
+    {
+        const QJsonObject object = value.toObject();
+
+        Project project;
+        project.gmkFileName = resolvePath(base, object.value("gmk").toString());
+        project.gms1folder = resolvePath(base, object.value("gms1").toString());
+        project.gms2folder = resolvePath(base, object.value("gms2").toString());
+        project.breakToExit = object.value("breakToExit").toBool();
+
+        const QJsonArray replacements = object.value("replace").toArray();
+        for (const QJsonValue& replacement : replacements)
+        {
+            project.replacements.append(qMakePair(replacement.toObject().value("from").toString(), replacement.toObject().value("to").toString()));
+        }
+
+        project.name = object.value("name").toString();
+        if (project.name.isEmpty())
+        {
+            project.name = !project.gmkFileName.isEmpty() ? QFileInfo(project.gmkFileName).completeBaseName() : QFileInfo(project.gms2folder).fileName();
+        }
+
+        projects.append(project);
+    }
+
+    if (projects.isEmpty())
+    {
+        error = QString("Manifest \"%1\" does not contain any projects").arg(fileName);
+    }
+
+    return projects;
+}
+
+QVector<BatchConverter::ProjectResult> BatchConverter::run(const QVector<Project> &projects) const
+{
+    QThreadPool pool;
+    if (maxThreadCount > 0)
+    {
+        pool.setMaxThreadCount(maxThreadCount);
+    }
+
+    // Cache entries are in use until the run ends, so they can only be evicted before it
+    const GmkSplitCache::Usage cacheUsage;
+
+    // Warnings and errors of the run are counted by event for the summary, they stay stored until the next run
+    Logger::enableStore(Logger::Severity::Warning, MaxStoredRecords);
+    Logger::clearRecords();
+
+    const int prevMaxConcurrentIo = IoThrottle::maxConcurrentIo();
+    IoThrottle::setMaxConcurrentIo(maxConcurrentIo);
+
+    const int prevSplitWorkerThreads = GmkSplitWorker::threadCount();
+    GmkSplitWorker::setThreadCount(splitWorkerThreads);
+
+    std::vector<std::unique_ptr<ProjectState>> states;
+    states.reserve(projects.count());
+
+    for (const Project& project : projects)
+    {
+        states.emplace_back(new ProjectState());
+        states.back()->project = project;
+
+        if (snapshotsEnabled)
+        {
+            // Started before any task, so every first change of a file is caught
+            for (const QString& folder : { project.gms1folder, project.gms2folder })
+            {
+                if (!folder.isEmpty())
+                {
+                    states.back()->snapshotRoots.append(folder);
+                    states.back()->snapshots.append(Snapshot::begin(folder));
+                }
+            }
+        }
+    }
+
+    for (const std::unique_ptr<ProjectState>& state_ : states)
+    {
+        ProjectState* state = state_.get();
+
+        const auto finishOne = [state]()
+        {
+            if (!state->pending.deref())
+            {
+                state->elapsedMs = state->timer.elapsed();
+            }
+        };
+
+        // done runs on the worker thread after the function, before the task counts as finished
+        const auto enqueue = [&pool, state, finishOne](std::function<bool()> function, std::function<void()> done)
+        {
+            state->tasks.ref();
+            state->pending.ref();
+
+            pool.start(new Task([state, finishOne, function, done]()
+            {
+                if (function())
+                {
+                    state->succeeded.ref();
+                }
+                else
+                {
+                    state->failed.ref();
+                }
+
+                if (done)
+                {
+                    done();
+                }
+
+                finishOne();
+            }));
+        };
+
+        // All edits of one file stay in one task, so they never race with each other
+        const auto enqueueEdits = [state, enqueue]()
+        {
+            const Project& project = state->project;
+            const bool breakToExit = project.breakToExit;
+            const QList<QPair<QString, QString>> replacements = project.replacements;
+
+            for (const QString& fileName : GMS2Corrector::findCodeFiles(project.gms2folder))
+            {
+                enqueue([fileName, breakToExit, replacements]()
+                {
+                    bool result = true;
+
+                    for (const QPair<QString, QString>& replacement : replacements)
+                    {
+                        result = GMS2Corrector::replaceInFile(fileName, replacement.first, replacement.second) && result;
+                    }
+
+                    if (breakToExit)
+                    {
+                        result = GMS2Corrector::breakToExitFile(fileName) && result;
+                    }
+
+                    return result;
+                }, nullptr);
+            }
+        };
+
+        state->pending.ref();
+
+        pool.start(new Task([state, enqueue, enqueueEdits, finishOne]()
+        {
+            state->timer.start();
+
+            const Project& project = state->project;
+
+            bool prepared = true;
+
+            // Without a GMS1 folder the GMK is corrected straight into the GMS2 project
+            const bool gmkToGms2 = !project.gmkFileName.isEmpty() && project.gms1folder.isEmpty() && !project.gms2folder.isEmpty();
+
+            bool editGms2 = !project.gms2folder.isEmpty() && (project.breakToExit || !project.replacements.isEmpty());
+            if (editGms2 && !GMS2Corrector::checkInput(project.gms2folder))
+            {
+                editGms2 = false;
+                prepared = false;
+            }
+
+            // The GMK tasks of gmkToGms2 write the same .gml files the text edits change, and create
+            // room and instance creation code files. The edits are listed and queued once the last of them finished
+            std::function<void()> gms2Done;
+            if (editGms2 && gmkToGms2)
+            {
+                // pending is held by the edits until they are queued, gms2Pending by this task until the GMK tasks are queued
+                state->pending.ref();
+                state->gms2Pending.ref();
+
+                gms2Done = [state, enqueueEdits, finishOne]()
+                {
+                    if (!state->gms2Pending.deref())
+                    {
+                        enqueueEdits();
+                        finishOne();
+                    }
+                };
+            }
+
+            const auto enqueueGms2 = [state, enqueue, gms2Done](std::function<bool()> function)
+            {
+                if (gms2Done)
+                {
+                    state->gms2Pending.ref();
+                }
+
+                enqueue(function, gms2Done);
+            };
+
+            if (gmkToGms2)
+            {
+                const QString gms2folder = project.gms2folder;
+
+                const QString gmkSplitOutput = state->workDir.isValid() && GMS2Corrector::checkInput(project.gmkFileName, gms2folder)
+                        ? GMS1Corrector::splitGmkCached(project.gmkFileName, state->workDir.filePath("gmksplit_output"))
+                        : QString();
+
+                if (!gmkSplitOutput.isEmpty())
+                {
+                    for (const QString& fileName : GMS1Corrector::findScripts(gmkSplitOutput))
+                    {
+                        enqueueGms2([fileName, gms2folder]() { return GMS2Corrector::copyScript(fileName, gms2folder); });
+                    }
+
+                    for (const QString& dirName : GMS1Corrector::findObjects(gmkSplitOutput))
+                    {
+                        enqueueGms2([state, dirName, gms2folder]() { return GMS2Corrector::correctObject(dirName, gms2folder, state->codeStats); });
+                    }
+
+                    for (const QString& fileName : GMS1Corrector::findRooms(gmkSplitOutput))
+                    {
+                        enqueueGms2([state, fileName, gms2folder]() { return GMS2Corrector::correctRoom(fileName, gms2folder, state->codeStats); });
+                    }
+                }
+                else
+                {
+                    prepared = false;
+                }
+            }
+            else if (!project.gmkFileName.isEmpty() || !project.gms1folder.isEmpty())
+            {
+                const QString gms1folder = project.gms1folder;
+
+                const QString gmkSplitOutput = state->workDir.isValid() && GMS1Corrector::checkInput(project.gmkFileName, gms1folder)
+                        ? GMS1Corrector::splitGmkCached(project.gmkFileName, state->workDir.filePath("gmksplit_output"))
+                        : QString();
+
+                if (!gmkSplitOutput.isEmpty())
+                {
+                    for (const QString& fileName : GMS1Corrector::findScripts(gmkSplitOutput))
+                    {
+                        enqueue([fileName, gms1folder]() { return GMS1Corrector::copyScript(fileName, gms1folder); }, nullptr);
+                    }
+
+                    for (const QString& dirName : GMS1Corrector::findObjects(gmkSplitOutput))
+                    {
+                        enqueue([state, dirName, gms1folder]() { return GMS1Corrector::correctObject(dirName, gms1folder, state->codeStats); }, nullptr);
+                    }
+
+                    for (const QString& fileName : GMS1Corrector::findRooms(gmkSplitOutput))
+                    {
+                        enqueue([state, fileName, gms1folder]() { return GMS1Corrector::correctRoom(fileName, gms1folder, state->codeStats); }, nullptr);
+                    }
+                }
+                else
+                {
+                    prepared = false;
+                }
+            }
+
+            state->prepared = prepared;
+
+            if (gms2Done)
+            {
+                // Also when the GMK could not be split, the edits still run
+                gms2Done();
+            }
+            else if (editGms2)
+            {
+                // The GMS1 project is a different folder, the edits run at the same time as its tasks
+                enqueueEdits();
+            }
+
+            finishOne();
+        }));
+    }
+
+    pool.waitForDone();
+
+    for (const std::unique_ptr<ProjectState>& state : states)
+    {
+        QStringList snapshots;
+
+        for (int i = 0; i < state->snapshotRoots.count(); ++i)
+        {
+            if (Snapshot::end(state->snapshotRoots.at(i)))
+            {
+                snapshots.append(state->snapshots.at(i));
+            }
+        }
+
+        state->snapshots = snapshots;
+    }
+
+    GmkSplitWorker::stop();
+    GmkSplitWorker::setThreadCount(prevSplitWorkerThreads);
+
+    IoThrottle::setMaxConcurrentIo(prevMaxConcurrentIo);
+
+    CodePool::Stats codeStats;
+    for (const std::unique_ptr<ProjectState>& state : states)
+    {
+        codeStats += state->codeStats.stats();
+    }
+
+    GMS1Corrector::logCodeStats(codeStats);
+
+    QVector<ProjectResult> results;
+    results.reserve(projects.count());
+
+    for (const std::unique_ptr<ProjectState>& state : states)
+    {
+        ProjectResult result;
+        result.name = state->project.name;
+        result.prepared = state->prepared;
+        result.tasks = state->tasks.load();
+        result.succeeded = state->succeeded.load();
+        result.failed = state->failed.load();
+        result.elapsedMs = state->elapsedMs;
+        result.snapshots = state->snapshots;
+
+        results.append(result);
+    }
+
+    return results;
+}
+
+QString BatchConverter::summary(const QVector<ProjectResult> &results)
+{
+    QString text;
+
+    int failedProjects = 0;
+
+    for (const ProjectResult& result : results)
+    {
+        const bool ok = result.prepared && result.failed == 0;
+        if (!ok)
+        {
+            failedProjects++;
+        }
+
+        text += QString("%1: %2, files: %3, succeeded: %4, failed: %5, time: %6 ms\n")
+                .arg(result.name, ok ? "OK" : "FAILED")
+                .arg(result.tasks).arg(result.succeeded).arg(result.failed).arg(result.elapsedMs);
+
+        for (const QString& snapshot : result.snapshots)
+        {
+            text += QString("    snapshot: %1\n").arg(snapshot);
+        }
+    }
+
+    text += QString("Projects: %1, failed: %2\n").arg(results.count()).arg(failedProjects);
+
+    const QJsonArray events = storedEvents();
+    if (!events.isEmpty())
+    {
+        text += "Warnings and errors:\n";
+
+        for (const QJsonValue& value : events)
+        {
+            const QJsonObject event = value.toObject();
+            const QJsonArray examples = event.value("examples").toArray();
+
+            text += QString("    %1: %2").arg(event.value("event").toString()).arg(event.value("count").toInt());
+            text += examples.isEmpty() ? QString("\n") : ", e.g. " + examples.at(0).toString() + "\n";
+        }
+    }
+
+    return text;
+}
+
+bool BatchConverter::saveSummary(const QString &fileName, const QVector<ProjectResult> &results)
+{
+    QJsonArray projects;
+
+    for (const ProjectResult& result : results)
+    {
+        QJsonObject object;
+        object.insert("name", result.name);
+        object.insert("prepared", result.prepared);
+        object.insert("files", result.tasks);
+        object.insert("succeeded", result.succeeded);
+        object.insert("failed", result.failed);
+        object.insert("elapsedMs", result.elapsedMs);
+        object.insert("snapshots", QJsonArray::fromStringList(result.snapshots));
+
+        projects.append(object);
+    }
+
+    QJsonObject root;
+    root.insert("projects", projects);
+    root.insert("events", storedEvents());
+
+    QFile file(fileName);
+    if (!file.open(QFile::WriteOnly | QFile::Truncate))
+    {
+        return false;
+    }
+
+    file.write(QJsonDocument(root).toJson());
+
+    return true;
+}
+
+QJsonObject BatchConverter::audit(const QVector<Project> &projects) const
+{
+    const GmkSplitCache::Usage cacheUsage;
+
+    const int prevMaxConcurrentIo = IoThrottle::maxConcurrentIo();
+    IoThrottle::setMaxConcurrentIo(maxConcurrentIo);
+
+    const int prevSplitWorkerThreads = GmkSplitWorker::threadCount();
+    GmkSplitWorker::setThreadCount(splitWorkerThreads);
+
+    const int prevMaxThreadCount = QThreadPool::globalInstance()->maxThreadCount();
+    if (maxThreadCount > 0)
+    {
+        QThreadPool::globalInstance()->setMaxThreadCount(maxThreadCount);
+    }
+
+    CodeStats codeStats;
+
+    // Projects go one after another, every audit is already parallel over the resources of its project
+    QJsonArray reports;
+
+    for (const Project& project : projects)
+    {
+        // Listed anyway, so the report shows every project of the manifest
+        if (project.gmkFileName.isEmpty() || project.gms1folder.isEmpty())
+        {
+            QJsonObject report;
+            report.insert("name", project.name);
+            report.insert("gmk", project.gmkFileName);
+            report.insert("gms1", project.gms1folder);
+            report.insert("skipped", true);
+            report.insert("error", "Skipped, the audit needs both gmk and gms1");
+
+            reports.append(report);
+            continue;
+        }
+
+        QJsonObject report = GMS1Corrector::audit(project.gmkFileName, project.gms1folder, codeStats);
+        report.insert("name", project.name);
+
+        reports.append(report);
+    }
+
+    QThreadPool::globalInstance()->setMaxThreadCount(prevMaxThreadCount);
+
+    GmkSplitWorker::stop();
+    GmkSplitWorker::setThreadCount(prevSplitWorkerThreads);
+    IoThrottle::setMaxConcurrentIo(prevMaxConcurrentIo);
+
+    const CodePool::Stats totalCodeStats = codeStats.stats();
+
+    QJsonObject codes;
+    codes.insert("blocks", totalCodeStats.blocks);
+    codes.insert("uniqueBlocks", totalCodeStats.uniqueBlocks);
+    codes.insert("duplicateBytes", totalCodeStats.duplicateBytes);
+
+    QJsonObject root;
+    root.insert("projects", reports);
+    root.insert("codes", codes);
+
+    return root;
+}
+
+bool BatchConverter::saveReport(const QString &fileName, const QJsonObject &report)
+{
+    QFile file(fileName);
+    if (!file.open(QFile::WriteOnly | QFile::Truncate))
+    {
+        return false;
+    }
+
+    file.write(QJsonDocument(report).toJson());
+
+    return true;
+}
+
+bool BatchConverter::hasDivergences(const QJsonObject &report)
+{
+    for (const QJsonValue& value : report.value("projects").toArray())
+    {
+        const QJsonObject project = value.toObject();
+
+        // A skipped project was not compared, it has nothing to diverge
+        if (project.value("skipped").toBool())
+        {
+            continue;
+        }
+
+        if (project.contains("error") || project.value("divergenceCount").toInt() > 0)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QPair>
+#include <QList>
+#include <QJsonObject>
+
+// Runs corrections for many projects at once. Every project is split into per-file tasks
+// that share one thread pool, so a project with a few huge rooms does not hold back the others
+class BatchConverter
+{
+public:
+    struct Project
+    {
+        QString name;
+        QString gmkFileName;
+        QString gms1folder;
+        QString gms2folder;
+        bool breakToExit = false;
+        QList<QPair<QString, QString>> replacements;
+    };
+
+    struct ProjectResult
+    {
+        QString name;
+        bool prepared = false;
+        int tasks = 0;
+        int succeeded = 0;
+        int failed = 0;
+        qint64 elapsedMs = 0;
+        QStringList snapshots; // folders for --restore, only the ones with changed files
+    };
+
+    static QVector<Project> loadManifest(const QString& fileName, QString& error);
+    static QString summary(const QVector<ProjectResult>& results);
+    static bool saveSummary(const QString& fileName, const QVector<ProjectResult>& results);
+
+    void setMaxThreadCount(int count) { maxThreadCount = count; }
+    void setMaxConcurrentIo(int count) { maxConcurrentIo = count; }
+    void setSplitWorkerThreads(int count) { splitWorkerThreads = count; }
+    void setSnapshotsEnabled(bool enabled) { snapshotsEnabled = enabled; }
+
+    QVector<ProjectResult> run(const QVector<Project>& projects) const;
+
+    // Compares GMK and GMS1 of every project without modifying anything
+    QJsonObject audit(const QVector<Project>& projects) const;
+    static bool saveReport(const QString& fileName, const QJsonObject& report);
+    static bool hasDivergences(const QJsonObject& report);
+
+private:
+    int maxThreadCount = 0; // 0 - number of CPU cores
+    int maxConcurrentIo = 0; // 0 - unlimited
+    int splitWorkerThreads = 1; // 0 - gmksplit is started for every GMK
+    bool snapshotsEnabled = true;
+};
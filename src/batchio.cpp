@@ -0,0 +1,324 @@
+#include "batchio.h"
+#include "iothrottle.h"
+#include <QFile>
+#include <QtConcurrent>
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+#ifdef GMLH_HAVE_LIBURING
+#include <liburing.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <climits>
+#endif
+
+namespace
+{
+
+// Fewer files are not worth a batch
+static const int MinBatchFiles = 4;
+
+bool readFileBlocking(const QString& fileName, QByteArray& data)
+{
+    IoThrottle::Guard guard;
+
+    QFile file(fileName);
+    if (!file.open(QFile::ReadOnly))
+    {
+        return false;
+    }
+
+    data = file.readAll();
+
+    return true;
+}
+
+#ifdef GMLH_HAVE_LIBURING
+
+// Every file of a window takes two entries while it is opened
+static const unsigned QueueDepth = 256;
+static const int WindowSize = QueueDepth / 2;
+
+enum Operation : quint64
+{
+    OpenOperation,
+    StatxOperation,
+    ReadOperation,
+    CloseOperation,
+};
+
+class Ring
+{
+public:
+    Ring()
+    {
+        ok = io_uring_queue_init(QueueDepth, &ring, 0) == 0;
+    }
+
+    ~Ring()
+    {
+        if (ok)
+        {
+            io_uring_queue_exit(&ring);
+        }
+    }
+
+    bool ok = false;
+    io_uring ring;
+};
+
+// One ring per thread, the correctors read from many threads at once
+Ring& threadRing()
+{
+    static thread_local Ring ring;
+    return ring;
+}
+
+void prepare(io_uring_sqe* sqe, int index, Operation operation)
+{
+    io_uring_sqe_set_data(sqe, reinterpret_cast<void*>((quint64(index) << 2) | operation));
+}
+
+// Submits everything prepared and waits for count completions
+template<typename Function>
+bool complete(io_uring& ring, int count, Function onCompletion)
+{
+    if (count == 0)
+    {
+        return true;
+    }
+
+    if (io_uring_submit_and_wait(&ring, count) < 0)
+    {
+        return false;
+    }
+
+    for (int i = 0; i < count; ++i)
+    {
+        io_uring_cqe* cqe = nullptr;
+        if (io_uring_wait_cqe(&ring, &cqe) < 0)
+        {
+            return false;
+        }
+
+        const quint64 data = reinterpret_cast<quint64>(io_uring_cqe_get_data(cqe));
+        onCompletion(int(data >> 2), Operation(data & 3), cqe->res);
+
+        io_uring_cqe_seen(&ring, cqe);
+    }
+
+    return true;
+}
+
+#endif
+
+}
+
+QVector<BatchIo::ReadResult> BatchIo::readFiles(const QStringList &fileNames, bool text)
+{
+    QVector<ReadResult> results(fileNames.count());
+
+    if (fileNames.count() < MinBatchFiles || !readFilesUring(fileNames, results))
+    {
+        readFilesBlocking(fileNames, results);
+    }
+    else
+    {
+        // Files io_uring could not read, a short read or an operation the kernel does not support
+        QStringList retryFileNames;
+        QVector<int> retryIndexes;
+
+        for (int i = 0; i < results.count(); ++i)
+        {
+            if (!results.at(i).ok)
+            {
+                retryFileNames.append(fileNames.at(i));
+                retryIndexes.append(i);
+            }
+        }
+
+        if (!retryIndexes.isEmpty())
+        {
+            QVector<ReadResult> retryResults(retryIndexes.count());
+            readFilesBlocking(retryFileNames, retryResults);
+
+            for (int i = 0; i < retryIndexes.count(); ++i)
+            {
+                results[retryIndexes.at(i)] = retryResults.at(i);
+            }
+        }
+    }
+
+    if (text)
+    {
+        for (ReadResult& result : results)
+        {
+            result.data.replace("\r\n", "\n");
+        }
+    }
+
+    return results;
+}
+
+QString BatchIo::backendName()
+{
+#ifdef GMLH_HAVE_LIBURING
+    if (threadRing().ok)
+    {
+        return "io_uring";
+    }
+#endif
+
+    return "thread pool";
+}
+
+void BatchIo::readFilesBlocking(const QStringList &fileNames, QVector<ReadResult> &results)
+{
+    if (fileNames.count() < MinBatchFiles)
+    {
+        for (int i = 0; i < fileNames.count(); ++i)
+        {
+            results[i].ok = readFileBlocking(fileNames.at(i), results[i].data);
+        }
+
+        return;
+    }
+
+    std::vector<int> indexes(fileNames.count());
+    std::iota(indexes.begin(), indexes.end(), 0);
+
+    QtConcurrent::blockingMap(indexes, [&fileNames, &results](int i)
+    {
+        results[i].ok = readFileBlocking(fileNames.at(i), results[i].data);
+    });
+}
+
+bool BatchIo::readFilesUring(const QStringList &fileNames, QVector<ReadResult> &results)
+{
+#ifdef GMLH_HAVE_LIBURING
+    Ring& ring = threadRing();
+    if (!ring.ok)
+    {
+        return false;
+    }
+
+    // Every file in flight counts as one file operation, so a window is never wider than the limit
+    const int maxWindow = IoThrottle::maxConcurrentIo() > 0 ? std::min(WindowSize, IoThrottle::maxConcurrentIo()) : WindowSize;
+
+    for (int begin = 0; begin < fileNames.count(); begin += maxWindow)
+    {
+        const int count = std::min(maxWindow, fileNames.count() - begin);
+        IoThrottle::Guard guard(count);
+
+        std::vector<QByteArray> paths(count);
+        std::vector<struct statx> stats(count);
+        std::vector<int> fds(count, -1);
+        std::vector<bool> sized(count, false);
+
+        for (int i = 0; i < count; ++i)
+        {
+            paths[i] = QFile::encodeName(fileNames.at(begin + i));
+
+            io_uring_sqe* sqe = io_uring_get_sqe(&ring.ring);
+            io_uring_prep_openat(sqe, AT_FDCWD, paths[i].constData(), O_RDONLY | O_CLOEXEC, 0);
+            prepare(sqe, i, OpenOperation);
+
+            sqe = io_uring_get_sqe(&ring.ring);
+            io_uring_prep_statx(sqe, AT_FDCWD, paths[i].constData(), 0, STATX_SIZE, &stats[i]);
+            prepare(sqe, i, StatxOperation);
+        }
+
+        bool ok = complete(ring.ring, count * 2, [&fds, &sized](int i, Operation operation, int result)
+        {
+            if (operation == OpenOperation && result >= 0)
+            {
+                fds[i] = result;
+            }
+            else if (operation == StatxOperation && result == 0)
+            {
+                sized[i] = true;
+            }
+        });
+
+        int reads = 0;
+
+        if (ok)
+        {
+            for (int i = 0; i < count; ++i)
+            {
+                if (fds[i] < 0 || !sized[i] || stats[i].stx_size > quint64(INT_MAX / 2))
+                {
+                    continue;
+                }
+
+                ReadResult& result = results[begin + i];
+                result.data.resize(int(stats[i].stx_size));
+
+                if (result.data.isEmpty())
+                {
+                    result.ok = true;
+                    continue;
+                }
+
+                io_uring_sqe* sqe = io_uring_get_sqe(&ring.ring);
+                io_uring_prep_read(sqe, fds[i], result.data.data(), unsigned(result.data.size()), 0);
+                prepare(sqe, i, ReadOperation);
+
+                reads++;
+            }
+
+            ok = complete(ring.ring, reads, [&results, begin](int i, Operation, int result)
+            {
+                ReadResult& readResult = results[begin + i];
+                readResult.ok = result == readResult.data.size();
+            });
+        }
+
+        int closes = 0;
+
+        if (ok)
+        {
+            for (int i = 0; i < count; ++i)
+            {
+                if (fds[i] >= 0)
+                {
+                    io_uring_sqe* sqe = io_uring_get_sqe(&ring.ring);
+                    io_uring_prep_close(sqe, fds[i]);
+                    prepare(sqe, i, CloseOperation);
+
+                    // Closing again after a failed close could hit a reused descriptor
+                    fds[i] = -1;
+                    closes++;
+                }
+            }
+
+            ok = complete(ring.ring, closes, [](int, Operation, int) {});
+        }
+
+        for (int i = 0; i < count; ++i)
+        {
+            if (fds[i] >= 0)
+            {
+                ::close(fds[i]);
+            }
+        }
+
+        if (!ok)
+        {
+            // The ring is in an unknown state, it is not used again. Whatever is not read yet goes the blocking way
+            io_uring_queue_exit(&ring.ring);
+            ring.ok = false;
+            return true;
+        }
+    }
+
+    return true;
+#else
+    Q_UNUSED(fileNames)
+    Q_UNUSED(results)
+
+    return false;
+#endif
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <QByteArray>
+#include <QStringList>
+#include <QVector>
+
+// Reads many small files at once. Built with liburing (GMLH_HAVE_LIBURING) the opens, reads and
+// closes go to io_uring in batches, otherwise, or when the kernel refuses io_uring, the files
+// are read by the global thread pool
+class BatchIo
+{
+public:
+    struct ReadResult
+    {
+        QByteArray data;
+        bool ok = false;
+    };
+
+    // Results are in the order of fileNames. text - "\r\n" is read as "\n", like QFile::Text does
+    static QVector<ReadResult> readFiles(const QStringList& fileNames, bool text);
+
+    static QString backendName();
+
+private:
+    static bool readFilesUring(const QStringList& fileNames, QVector<ReadResult>& results);
+    static void readFilesBlocking(const QStringList& fileNames, QVector<ReadResult>& results);
+};
@@ -0,0 +1,113 @@
+#include "codepool.h"
+#include <QCryptographicHash>
+
+int CodePool::intern(const QString &code)
+{
+    QMutexLocker locker(&mutex);
+
+    currentStats.blocks++;
+
+    const auto it = ids.constFind(code);
+    if (it != ids.constEnd())
+    {
+        currentStats.duplicateBytes += code.size() * qint64(sizeof(QChar));
+        return it.value();
+    }
+
+    const int id = codes.count();
+    ids.insert(code, id);
+    codes.append(code);
+    hashes.append(QString());
+
+    currentStats.uniqueBlocks++;
+
+    return id;
+}
+
+int CodePool::find(const QString &code) const
+{
+    QMutexLocker locker(&mutex);
+
+    return ids.value(code, -1);
+}
+
+QString CodePool::code(int id) const
+{
+    QMutexLocker locker(&mutex);
+
+    return codes.value(id);
+}
+
+QString CodePool::hash(int id)
+{
+    QString text;
+
+    {
+        QMutexLocker locker(&mutex);
+
+        if (id < 0 || id >= codes.count())
+        {
+            return QString();
+        }
+
+        if (!hashes.at(id).isEmpty())
+        {
+            return hashes.at(id);
+        }
+
+        text = codes.at(id);
+    }
+
+    // Hashed without the lock, two threads may hash the same block at worst
+    const QString result = QString::fromLatin1(QCryptographicHash::hash(text.toUtf8(), QCryptographicHash::Sha1).toHex().left(16));
+
+    QMutexLocker locker(&mutex);
+    if (id < hashes.count())
+    {
+        hashes[id] = result;
+    }
+
+    return result;
+}
+
+CodePool::Stats CodePool::stats() const
+{
+    QMutexLocker locker(&mutex);
+
+    return currentStats;
+}
+
+void CodePool::clear()
+{
+    QMutexLocker locker(&mutex);
+
+    ids.clear();
+    codes.clear();
+    hashes.clear();
+    currentStats = Stats();
+}
+
+void CodeStats::add(const CodePool::Stats &stats)
+{
+    QMutexLocker locker(&mutex);
+
+    total += stats;
+}
+
+CodePool::Stats CodeStats::stats() const
+{
+    QMutexLocker locker(&mutex);
+
+    return total;
+}
+
+CodeStats::Scope::Scope(CodeStats &codeStats, const CodePool &codes)
+    : codeStats(codeStats)
+    , codes(codes)
+{
+}
+
+CodeStats::Scope::~Scope()
+{
+    codeStats.add(codes.stats());
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+
+// Code blocks stored once per content. Identical code of the events of an object or the instances
+// of a room shares one id and one copy of the text, and is hashed once. Thread safe
+class CodePool
+{
+public:
+    struct Stats
+    {
+        int blocks = 0; // interned code blocks, duplicates included
+        int uniqueBlocks = 0;
+        qint64 duplicateBytes = 0; // UTF-16 bytes of the duplicates
+
+        Stats& operator+=(const Stats& other)
+        {
+            blocks += other.blocks;
+            uniqueBlocks += other.uniqueBlocks;
+            duplicateBytes += other.duplicateBytes;
+            return *this;
+        }
+    };
+
+    int intern(const QString& code);
+    // -1 - the code is not in the pool. Does not count as a block
+    int find(const QString& code) const;
+    QString code(int id) const;
+    // Short SHA1 of the code, computed on the first call
+    QString hash(int id);
+    Stats stats() const;
+    void clear();
+
+private:
+    mutable QMutex mutex;
+    QHash<QString, int> ids;
+    QVector<QString> codes;
+    QVector<QString> hashes;
+    Stats currentStats;
+};
+
+// Stats of many pools, the resources of a project add the stats of their pools from many threads
+class CodeStats
+{
+public:
+    void add(const CodePool::Stats& stats);
+    CodePool::Stats stats() const;
+
+    // Adds the stats of the pool of a resource when it goes out of scope, on any return
+    class Scope
+    {
+    public:
+        Scope(CodeStats& codeStats, const CodePool& codes);
+        ~Scope();
+
+    private:
+        Q_DISABLE_COPY(Scope)
+        CodeStats& codeStats;
+        const CodePool& codes;
+    };
+
+private:
+    mutable QMutex mutex;
+    CodePool::Stats total;
+};
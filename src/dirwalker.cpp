@@ -0,0 +1,230 @@
+#include "dirwalker.h"
+#include <QtConcurrent>
+#include <QDir>
+#include <algorithm>
+
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#endif
+
+namespace
+{
+
+#ifdef Q_OS_LINUX
+struct LinuxDirent64
+{
+    ino64_t d_ino;
+    off64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+#endif
+
+}
+
+QVector<DirWalker::Entry> DirWalker::walk(const QString &root_, const Options &options_)
+{
+    const QString root = QDir::cleanPath(root_);
+
+    Options options = options_;
+    for (QString& prunedDir : options.prunedDirs)
+    {
+        prunedDir = root + '/' + prunedDir;
+    }
+
+    QVector<Entry> result;
+
+    QStringList level = { root };
+    while (!level.isEmpty())
+    {
+        const QList<Listing> listings = QtConcurrent::blockingMapped<QList<Listing>>(level, [&options](const QString& dirName)
+        {
+            return listDir(dirName, options);
+        });
+
+        level.clear();
+
+        for (const Listing& listing : listings)
+        {
+            result += listing.matched;
+            level += listing.subdirs;
+        }
+    }
+
+    std::sort(result.begin(), result.end(), [](const Entry& a, const Entry& b)
+    {
+        return a.path < b.path;
+    });
+
+    return result;
+}
+
+QStringList DirWalker::findFiles(const QString &root, const QStringList &suffixes, const QStringList &prunedDirs)
+{
+    Options options;
+    options.type = EntryType::File;
+    options.suffixes = suffixes;
+    options.prunedDirs = prunedDirs;
+
+    QStringList result;
+    for (const Entry& entry : walk(root, options))
+    {
+        result.append(entry.path);
+    }
+
+    return result;
+}
+
+QStringList DirWalker::findDirs(const QString &root, const QStringList &suffixes, const QStringList &prunedDirs)
+{
+    Options options;
+    options.type = EntryType::Dir;
+    options.suffixes = suffixes;
+    options.prunedDirs = prunedDirs;
+
+    QStringList result;
+    for (const Entry& entry : walk(root, options))
+    {
+        result.append(entry.path);
+    }
+
+    return result;
+}
+
+DirWalker::Listing DirWalker::listDir(const QString &dirName, const Options &options)
+{
+    Listing listing;
+
+    const auto addEntry = [&listing, &options, &dirName](const QString& name, EntryType type)
+    {
+        if (name.startsWith('.'))
+        {
+            return;
+        }
+
+        if (type == options.type && isMatched(name, options))
+        {
+            Entry entry;
+            entry.path = dirName + '/' + name;
+            entry.name = name;
+            entry.type = type;
+
+            listing.matched.append(entry);
+        }
+        else if (type == EntryType::Dir)
+        {
+            const QString path = dirName + '/' + name;
+            if (!isPruned(path, options))
+            {
+                listing.subdirs.append(path);
+            }
+        }
+    };
+
+#ifdef Q_OS_LINUX
+    const int fd = openat(AT_FDCWD, QFile::encodeName(dirName).constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd == -1)
+    {
+        return listing;
+    }
+
+    alignas(LinuxDirent64) char buffer[64 * 1024];
+
+    while (true)
+    {
+        const long size = syscall(SYS_getdents64, fd, buffer, sizeof(buffer));
+        if (size <= 0)
+        {
+            break;
+        }
+
+        for (long offset = 0; offset < size;)
+        {
+            const LinuxDirent64* dirent = reinterpret_cast<const LinuxDirent64*>(buffer + offset);
+            offset += dirent->d_reclen;
+
+            unsigned char type = dirent->d_type;
+            if (type == DT_UNKNOWN || type == DT_LNK)
+            {
+                // Like QDirIterator: symlinks to files are files, symlinks to directories are not entered
+                struct stat st;
+                if (fstatat(fd, dirent->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+                {
+                    continue;
+                }
+
+                if (S_ISLNK(st.st_mode))
+                {
+                    // Only the target of a symlink is followed, and only to tell files from everything else
+                    type = fstatat(fd, dirent->d_name, &st, 0) == 0 && S_ISREG(st.st_mode) ? DT_REG : DT_LNK;
+                }
+                else if (S_ISREG(st.st_mode))
+                {
+                    type = DT_REG;
+                }
+                else if (S_ISDIR(st.st_mode))
+                {
+                    type = DT_DIR;
+                }
+            }
+
+            if (type == DT_REG)
+            {
+                addEntry(QFile::decodeName(dirent->d_name), EntryType::File);
+            }
+            else if (type == DT_DIR)
+            {
+                const char* name = dirent->d_name;
+                if (qstrcmp(name, ".") != 0 && qstrcmp(name, "..") != 0)
+                {
+                    addEntry(QFile::decodeName(name), EntryType::Dir);
+                }
+            }
+        }
+    }
+
+    close(fd);
+#else
+    const QDir dir(dirName);
+
+    for (const QString& name : dir.entryList(QDir::Files))
+    {
+        addEntry(name, EntryType::File);
+    }
+
+    for (const QString& name : dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot | QDir::NoSymLinks))
+    {
+        addEntry(name, EntryType::Dir);
+    }
+#endif
+
+    return listing;
+}
+
+bool DirWalker::isMatched(const QString &name, const Options &options)
+{
+    if (options.suffixes.isEmpty())
+    {
+        return true;
+    }
+
+    for (const QString& suffix : options.suffixes)
+    {
+        if (name.endsWith(suffix, Qt::CaseInsensitive))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool DirWalker::isPruned(const QString &path, const Options &options)
+{
+    return options.prunedDirs.contains(path, Qt::CaseInsensitive);
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// Recursive directory search. Directories of one level are listed in parallel,
+// on Linux with getdents64 which gives the entry type without a stat call per entry
+class DirWalker
+{
+public:
+    enum class EntryType { File, Dir };
+
+    struct Entry
+    {
+        QString path;
+        QString name;
+        EntryType type = EntryType::File;
+    };
+
+    struct Options
+    {
+        EntryType type = EntryType::File;
+        QStringList suffixes; // case insensitive, empty - any name
+        QStringList prunedDirs; // paths relative to the root of directories that are not entered, case insensitive
+    };
+
+    // Matched directories are not entered. The result is sorted by path
+    static QVector<Entry> walk(const QString& root, const Options& options);
+
+    static QStringList findFiles(const QString& root, const QStringList& suffixes, const QStringList& prunedDirs = QStringList());
+    static QStringList findDirs(const QString& root, const QStringList& suffixes, const QStringList& prunedDirs = QStringList());
+
+private:
+    struct Listing
+    {
+        QVector<Entry> matched;
+        QStringList subdirs;
+    };
+
+    static Listing listDir(const QString& dirName, const Options& options);
+    static bool isMatched(const QString& name, const Options& options);
+    static bool isPruned(const QString& path, const Options& options);
+};
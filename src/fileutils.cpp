@@ -0,0 +1,347 @@
+#include "fileutils.h"
+#include "iothrottle.h"
+#include "snapshot.h"
+#include <QSaveFile>
+#include <QFileInfo>
+#include <QFile>
+#include <QUuid>
+#include <QDir>
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <algorithm>
+
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <linux/fs.h>
+#include <dirent.h>
+#endif
+
+namespace
+{
+
+// One thread is enough, every removal is parallel inside
+QThreadPool& removalPool()
+{
+    static QThreadPool pool;
+    pool.setMaxThreadCount(1);
+    return pool;
+}
+
+}
+
+FileUtils::Result FileUtils::writeIfChanged(const QString &fileName, const QByteArray &data)
+{
+    IoThrottle::Guard guard;
+
+    {
+        QFile file(fileName);
+        if (file.open(QFile::ReadOnly | QFile::Text) && file.size() >= data.size() && file.readAll() == data)
+        {
+            return Result::Unchanged;
+        }
+    }
+
+    Snapshot::preserve(fileName);
+
+    QSaveFile file(fileName);
+    if (!file.open(QFile::WriteOnly | QFile::Text))
+    {
+        return Result::Failed;
+    }
+
+    file.write(data);
+
+    if (!file.commit())
+    {
+        return Result::Failed;
+    }
+
+    return Result::Changed;
+}
+
+FileUtils::Result FileUtils::copyIfChanged(const QString &sourceFileName, const QString &destFileName)
+{
+    IoThrottle::Guard guard;
+
+    if (isSameContent(sourceFileName, destFileName))
+    {
+        return Result::Unchanged;
+    }
+
+    Snapshot::preserve(destFileName);
+
+    // Copy next to the destination and rename, so the destination is never left half written
+    const QString tempFileName = destFileName + ".tmp-" + QUuid::createUuid().toString(QUuid::WithoutBraces);
+
+    if (!copyFile(sourceFileName, tempFileName))
+    {
+        QFile::remove(tempFileName);
+        return Result::Failed;
+    }
+
+    if (QFile::exists(destFileName) && !QFile::remove(destFileName))
+    {
+        QFile::remove(tempFileName);
+        return Result::Failed;
+    }
+
+    if (!QFile::rename(tempFileName, destFileName))
+    {
+        QFile::remove(tempFileName);
+        return Result::Failed;
+    }
+
+    return Result::Changed;
+}
+
+bool FileUtils::isSameContent(const QString &fileName1, const QString &fileName2)
+{
+    const QFileInfo fileInfo1(fileName1);
+    const QFileInfo fileInfo2(fileName2);
+
+    if (!fileInfo1.exists() || !fileInfo2.exists() || fileInfo1.size() != fileInfo2.size())
+    {
+        return false;
+    }
+
+    QFile file1(fileName1);
+    QFile file2(fileName2);
+    if (!file1.open(QFile::ReadOnly) || !file2.open(QFile::ReadOnly))
+    {
+        return false;
+    }
+
+    static const qint64 BlockSize = 64 * 1024;
+
+    while (!file1.atEnd())
+    {
+        if (file1.read(BlockSize) != file2.read(BlockSize))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool FileUtils::copyFile(const QString &sourceFileName, const QString &destFileName)
+{
+#ifdef Q_OS_LINUX
+    const int sourceFd = open(QFile::encodeName(sourceFileName).constData(), O_RDONLY | O_CLOEXEC);
+    if (sourceFd == -1)
+    {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(sourceFd, &st) != 0)
+    {
+        close(sourceFd);
+        return false;
+    }
+
+    const int destFd = open(QFile::encodeName(destFileName).constData(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, st.st_mode & 0777);
+    if (destFd == -1)
+    {
+        close(sourceFd);
+        return false;
+    }
+
+    bool result = ioctl(destFd, FICLONE, sourceFd) == 0;
+
+    if (!result)
+    {
+        result = true;
+
+        off_t remaining = st.st_size;
+        while (remaining > 0)
+        {
+            const ssize_t copied = copy_file_range(sourceFd, nullptr, destFd, nullptr, static_cast<size_t>(remaining), 0);
+            if (copied <= 0)
+            {
+                result = false;
+                break;
+            }
+
+            remaining -= copied;
+        }
+    }
+
+    close(sourceFd);
+
+    if (close(destFd) != 0)
+    {
+        result = false;
+    }
+
+    if (result)
+    {
+        return true;
+    }
+
+    // copy_file_range is not supported between these filesystems, fall back to a plain copy
+    QFile::remove(destFileName);
+#endif
+
+    return QFile::copy(sourceFileName, destFileName);
+}
+
+bool FileUtils::cloneFile(const QString &sourceFileName, const QString &destFileName)
+{
+#ifdef Q_OS_LINUX
+    const int sourceFd = open(QFile::encodeName(sourceFileName).constData(), O_RDONLY | O_CLOEXEC);
+    if (sourceFd == -1)
+    {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(sourceFd, &st) != 0)
+    {
+        close(sourceFd);
+        return false;
+    }
+
+    const int destFd = open(QFile::encodeName(destFileName).constData(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, st.st_mode & 0777);
+    if (destFd == -1)
+    {
+        close(sourceFd);
+        return false;
+    }
+
+    bool result = ioctl(destFd, FICLONE, sourceFd) == 0;
+
+    close(sourceFd);
+
+    if (close(destFd) != 0)
+    {
+        result = false;
+    }
+
+    if (!result)
+    {
+        QFile::remove(destFileName);
+    }
+
+    return result;
+#else
+    Q_UNUSED(sourceFileName)
+    Q_UNUSED(destFileName)
+    return false;
+#endif
+}
+
+bool FileUtils::removeTree(const QString &dirName)
+{
+    if (!QFileInfo(dirName).isDir())
+    {
+        return !QFileInfo::exists(dirName);
+    }
+
+    // Files go level by level while the folders are listed, then the empty folders from the deepest level up
+    QVector<QStringList> levels;
+
+    QStringList level = { dirName };
+    while (!level.isEmpty())
+    {
+        levels.append(level);
+
+        const QList<QStringList> subdirs = QtConcurrent::blockingMapped<QList<QStringList>>(level, &FileUtils::removeFiles);
+
+        level.clear();
+        for (const QStringList& dirs : subdirs)
+        {
+            level += dirs;
+        }
+    }
+
+    for (int i = levels.count() - 1; i >= 0; --i)
+    {
+        QtConcurrent::blockingMap(levels[i], [](const QString& dir)
+        {
+            QDir().rmdir(dir);
+        });
+    }
+
+    if (QFileInfo::exists(dirName))
+    {
+        // Something was in the way, a read-only folder for example
+        return QDir(dirName).removeRecursively();
+    }
+
+    return true;
+}
+
+void FileUtils::removeTreeInBackground(const QString &dirName)
+{
+    QtConcurrent::run(&removalPool(), [dirName]()
+    {
+        removeTree(dirName);
+    });
+}
+
+void FileUtils::waitForBackgroundRemovals()
+{
+    removalPool().waitForDone();
+}
+
+QStringList FileUtils::removeFiles(const QString &dirName)
+{
+    QStringList subdirs;
+
+#ifdef Q_OS_LINUX
+    DIR* dir = opendir(QFile::encodeName(dirName).constData());
+    if (!dir)
+    {
+        return subdirs;
+    }
+
+    const int fd = dirfd(dir);
+
+    while (const dirent* entry = readdir(dir))
+    {
+        const char* name = entry->d_name;
+        if (qstrcmp(name, ".") == 0 || qstrcmp(name, "..") == 0)
+        {
+            continue;
+        }
+
+        bool isDir = entry->d_type == DT_DIR;
+        if (entry->d_type == DT_UNKNOWN)
+        {
+            struct stat st;
+            isDir = fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) == 0 && S_ISDIR(st.st_mode);
+        }
+
+        if (isDir)
+        {
+            subdirs.append(dirName + "/" + QFile::decodeName(name));
+        }
+        else
+        {
+            // A symlink is removed itself, never what it points to
+            unlinkat(fd, name, 0);
+        }
+    }
+
+    closedir(dir);
+#else
+    const QFileInfoList entries = QDir(dirName).entryInfoList(QDir::NoDotAndDotDot | QDir::System | QDir::Hidden | QDir::AllDirs | QDir::Files);
+    for (const QFileInfo& entry : entries)
+    {
+        if (entry.isDir() && !entry.isSymLink())
+        {
+            subdirs.append(entry.absoluteFilePath());
+        }
+        else
+        {
+            QFile::remove(entry.absoluteFilePath());
+        }
+    }
+#endif
+
+    return subdirs;
+}
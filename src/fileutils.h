@@ -0,0 +1,40 @@
+#pragma once
+
+#include <QString>
+#include <QByteArray>
+#include <QStringList>
+
+// File writes that leave files with the same content untouched, so their modification time is kept
+class FileUtils
+{
+public:
+    enum class Result
+    {
+        Failed,
+        Unchanged,
+        Changed,
+    };
+
+    // Text mode, line endings are converted like QFile::Text does. The file is replaced atomically
+    static Result writeIfChanged(const QString& fileName, const QByteArray& data);
+
+    // Binary copy. Uses reflink or copy_file_range where the system supports it
+    static Result copyIfChanged(const QString& sourceFileName, const QString& destFileName);
+
+    static bool isSameContent(const QString& fileName1, const QString& fileName2);
+
+    // Removes the folder with everything in it, the entries of a level are deleted in parallel
+    static bool removeTree(const QString& dirName);
+    // Returns at once, the folder is removed on a background thread
+    static void removeTreeInBackground(const QString& dirName);
+    // Waits for the background removals, called before the application exits
+    static void waitForBackgroundRemovals();
+
+    // Reflink only, fails where the file system can not share blocks
+    static bool cloneFile(const QString& sourceFileName, const QString& destFileName);
+
+private:
+    static bool copyFile(const QString& sourceFileName, const QString& destFileName);
+    // Deletes everything except subfolders and returns the subfolders
+    static QStringList removeFiles(const QString& dirName);
+};
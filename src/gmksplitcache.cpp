@@ -0,0 +1,310 @@
+#include "gmksplitcache.h"
+#include "dirwalker.h"
+#include "fileutils.h"
+#include <QCryptographicHash>
+#include <QStandardPaths>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QFile>
+#include <QDir>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QUuid>
+#include <QVector>
+#include <QMutex>
+#include <QLockFile>
+#include <algorithm>
+
+namespace
+{
+
+static qint64 maxCacheSize = 2LL * 1024 * 1024 * 1024;
+static QMutex cacheMutex;
+
+// Held while the cache is evicted or a usage is registered, by any process
+QString evictLockFileName()
+{
+    return GmkSplitCache::cacheFolder() + "/evict.lock";
+}
+
+QString usageFolder()
+{
+    return GmkSplitCache::cacheFolder() + "/users";
+}
+
+QByteArray fileHash(const QString& fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QFile::ReadOnly))
+    {
+        return QByteArray();
+    }
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    if (!hash.addData(&file))
+    {
+        return QByteArray();
+    }
+
+    return hash.result();
+}
+
+qint64 folderSize(const QString& folder)
+{
+    qint64 size = 0;
+
+    for (const QString& fileName : DirWalker::findFiles(folder, QStringList()))
+    {
+        size += QFileInfo(fileName).size();
+    }
+
+    return size;
+}
+
+}
+
+void GmkSplitCache::setMaxSize(qint64 bytes)
+{
+    maxCacheSize = std::max<qint64>(0, bytes);
+}
+
+qint64 GmkSplitCache::maxSize()
+{
+    return maxCacheSize;
+}
+
+bool GmkSplitCache::isEnabled()
+{
+    return maxCacheSize > 0 && !cacheFolder().isEmpty();
+}
+
+QString GmkSplitCache::cacheFolder()
+{
+    const QString cache = QStandardPaths::writableLocation(QStandardPaths::StandardLocation::CacheLocation);
+    if (cache.isEmpty())
+    {
+        return QString();
+    }
+
+    return cache + "/gmksplit";
+}
+
+QString GmkSplitCache::key(const QString &gmkFileName, const QString &gmkSplitFileName)
+{
+    const QByteArray gmkHash = fileHash(gmkFileName);
+    const QByteArray gmkSplitHash = fileHash(gmkSplitFileName);
+    if (gmkHash.isEmpty() || gmkSplitHash.isEmpty())
+    {
+        return QString();
+    }
+
+    return QString::fromLatin1(QCryptographicHash::hash(gmkHash + gmkSplitHash, QCryptographicHash::Sha1).toHex());
+}
+
+QString GmkSplitCache::find(const QString &key)
+{
+    if (key.isEmpty() || !isEnabled())
+    {
+        return QString();
+    }
+
+    QMutexLocker locker(&cacheMutex);
+
+    const QString folder = entryFolder(key);
+
+    QFile infoFile(entryInfoFileName(key));
+    if (!QFileInfo(folder).isDir() || !infoFile.open(QFile::ReadOnly))
+    {
+        return QString();
+    }
+
+    const qint64 size = QJsonDocument::fromJson(infoFile.readAll()).object().value("size").toVariant().toLongLong();
+    infoFile.close();
+
+    touch(key, size);
+
+    return folder;
+}
+
+QString GmkSplitCache::newEntryFolder(const QString &key)
+{
+    QDir().mkpath(cacheFolder());
+
+    return cacheFolder() + "/" + key + ".tmp-" + QUuid::createUuid().toString(QUuid::WithoutBraces);
+}
+
+QString GmkSplitCache::insert(const QString &key, const QString &outputFolder)
+{
+    const qint64 size = folderSize(outputFolder);
+
+    QMutexLocker locker(&cacheMutex);
+
+    const QString folder = entryFolder(key);
+
+    if (QFileInfo(folder).isDir())
+    {
+        // The same GMK was split by a concurrent task, keep the existing entry
+        FileUtils::removeTreeInBackground(outputFolder);
+    }
+    else if (!QDir().rename(outputFolder, folder))
+    {
+        FileUtils::removeTreeInBackground(outputFolder);
+        return QString();
+    }
+
+    touch(key, size);
+
+    return folder;
+}
+
+GmkSplitCache::Usage::Usage()
+{
+    if (!isEnabled())
+    {
+        return;
+    }
+
+    QDir().mkpath(usageFolder());
+
+    QLockFile evictLock(evictLockFileName());
+    evictLock.setStaleLockTime(0);
+    if (!evictLock.lock())
+    {
+        return;
+    }
+
+    if (!isUsedByOthers())
+    {
+        evict();
+    }
+
+    // Registered before the evict lock is released, so no other process evicts between the check and now
+    lockFile.reset(new QLockFile(usageFolder() + "/" + QUuid::createUuid().toString(QUuid::WithoutBraces) + ".lock"));
+    lockFile->setStaleLockTime(0);
+    if (!lockFile->tryLock(0))
+    {
+        lockFile.reset();
+    }
+}
+
+GmkSplitCache::Usage::~Usage()
+{
+    if (lockFile)
+    {
+        lockFile->unlock();
+    }
+}
+
+bool GmkSplitCache::isUsedByOthers()
+{
+    bool used = false;
+
+    for (const QFileInfo& fileInfo : QDir(usageFolder()).entryInfoList({ "*.lock" }, QDir::Files))
+    {
+        // The lock of a live run can not be taken. Locks left by crashed processes are stale and removed here
+        QLockFile probe(fileInfo.absoluteFilePath());
+        probe.setStaleLockTime(0);
+        if (probe.tryLock(0))
+        {
+            probe.unlock();
+        }
+        else
+        {
+            used = true;
+        }
+    }
+
+    return used;
+}
+
+void GmkSplitCache::evict()
+{
+    if (!isEnabled())
+    {
+        return;
+    }
+
+    QMutexLocker locker(&cacheMutex);
+
+    struct Entry
+    {
+        QString key;
+        qint64 size = 0;
+        qint64 lastUsed = 0;
+    };
+
+    QVector<Entry> entries;
+    qint64 totalSize = 0;
+
+    const QDir dir(cacheFolder());
+
+    for (const QFileInfo& fileInfo : dir.entryInfoList({ "*.json" }, QDir::Files))
+    {
+        QFile file(fileInfo.absoluteFilePath());
+        if (!file.open(QFile::ReadOnly))
+        {
+            continue;
+        }
+
+        const QJsonObject object = QJsonDocument::fromJson(file.readAll()).object();
+
+        Entry entry;
+        entry.key = fileInfo.completeBaseName();
+        entry.size = object.value("size").toVariant().toLongLong();
+        entry.lastUsed = object.value("lastUsed").toVariant().toLongLong();
+
+        totalSize += entry.size;
+        entries.append(entry);
+    }
+
+    // Leftovers of interrupted splits. Recent ones may belong to a split running in another process
+    const QDateTime staleTime = QDateTime::currentDateTime().addDays(-1);
+    for (const QFileInfo& fileInfo : dir.entryInfoList({ "*.tmp-*" }, QDir::Dirs))
+    {
+        if (fileInfo.lastModified() < staleTime)
+        {
+            FileUtils::removeTree(fileInfo.absoluteFilePath());
+        }
+    }
+
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b)
+    {
+        return a.lastUsed < b.lastUsed;
+    });
+
+    for (const Entry& entry : entries)
+    {
+        if (totalSize <= maxCacheSize)
+        {
+            break;
+        }
+
+        QFile::remove(entryInfoFileName(entry.key));
+        FileUtils::removeTree(entryFolder(entry.key));
+
+        totalSize -= entry.size;
+    }
+}
+
+QString GmkSplitCache::entryFolder(const QString &key)
+{
+    return cacheFolder() + "/" + key;
+}
+
+QString GmkSplitCache::entryInfoFileName(const QString &key)
+{
+    return cacheFolder() + "/" + key + ".json";
+}
+
+void GmkSplitCache::touch(const QString &key, qint64 size)
+{
+    QJsonObject object;
+    object.insert("size", size);
+    object.insert("lastUsed", QDateTime::currentMSecsSinceEpoch());
+
+    QFile file(entryInfoFileName(key));
+    if (file.open(QFile::WriteOnly | QFile::Truncate))
+    {
+        file.write(QJsonDocument(object).toJson(QJsonDocument::Compact));
+    }
+}
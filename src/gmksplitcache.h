@@ -0,0 +1,52 @@
+#pragma once
+
+#include <QString>
+#include <memory>
+
+class QLockFile;
+
+// Persistent cache of gmksplit output, keyed by the content of the GMK file and of gmksplit itself.
+// Every entry is a folder with a sibling JSON file that holds its size and last use time
+class GmkSplitCache
+{
+public:
+    // Marks the cache as used by this run, for other processes too. Entries are evicted when the
+    // first run starts, only if no other run in any process uses the cache
+    class Usage
+    {
+    public:
+        Usage();
+        ~Usage();
+
+    private:
+        Q_DISABLE_COPY(Usage)
+        std::unique_ptr<QLockFile> lockFile;
+    };
+
+    // 0 - cache disabled
+    static void setMaxSize(qint64 bytes);
+    static qint64 maxSize();
+    static bool isEnabled();
+
+    static QString cacheFolder();
+    static QString key(const QString& gmkFileName, const QString& gmkSplitFileName);
+
+    // Returns the folder of the entry or empty string
+    static QString find(const QString& key);
+
+    // Folder for new gmksplit output, located next to the entries so it can be moved into the cache with rename
+    static QString newEntryFolder(const QString& key);
+
+    // Moves the output into the cache, returns the folder of the entry. Empty string on failure, the output is removed then
+    static QString insert(const QString& key, const QString& outputFolder);
+
+private:
+    // Removes least recently used entries until the cache fits into the max size.
+    // Must be called while no entries are in use
+    static void evict();
+    static bool isUsedByOthers();
+
+    static QString entryFolder(const QString& key);
+    static QString entryInfoFileName(const QString& key);
+    static void touch(const QString& key, qint64 size);
+};
@@ -0,0 +1,290 @@
+#include "gmksplitworker.h"
+#include "logger.h"
+#include <QCoreApplication>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QProcess>
+#include <QSemaphore>
+#include <QStandardPaths>
+#include <QThread>
+#include <algorithm>
+
+namespace
+{
+
+using Severity = Logger::Severity;
+using Event = Logger::Event;
+
+struct Job
+{
+    QSemaphore done;
+    bool ok = false;
+};
+
+// Guards everything below. The process itself is only touched in its thread
+static QMutex workerMutex;
+static int workerThreadCount = 0;
+static QThread* workerThread = nullptr;
+static QObject* host = nullptr;
+static QProcess* process = nullptr;
+static bool failed = false;
+static bool stopping = false; // the exit is expected, stop() closed stdin
+static quint64 nextJobId = 0;
+static QHash<quint64, Job*> jobs;
+
+void failJobs()
+{
+    for (Job* job : jobs)
+    {
+        job->ok = false;
+        job->done.release();
+    }
+
+    jobs.clear();
+}
+
+void readAnswers()
+{
+    while (process->canReadLine())
+    {
+        const QStringList parts = QString::fromUtf8(process->readLine()).trimmed().split('\t');
+
+        QMutexLocker locker(&workerMutex);
+
+        Job* job = jobs.take(parts.value(0).toULongLong());
+        if (!job)
+        {
+            continue;
+        }
+
+        job->ok = parts.value(1) == "OK";
+        if (!job->ok)
+        {
+            Logger::log(Severity::Warning, Event::GmkSplitWorkerFailed, parts.value(2));
+        }
+
+        job->done.release();
+    }
+}
+
+}
+
+void GmkSplitWorker::setThreadCount(int count)
+{
+    QMutexLocker locker(&workerMutex);
+    workerThreadCount = std::max(count, 0);
+}
+
+int GmkSplitWorker::threadCount()
+{
+    QMutexLocker locker(&workerMutex);
+    return workerThreadCount;
+}
+
+bool GmkSplitWorker::isAvailable()
+{
+    return !javaFileName().isEmpty() && QFileInfo::exists(jarFileName()) && QFileInfo::exists(sourceFileName());
+}
+
+bool GmkSplitWorker::split(const QString &gmkFileName, const QString &gmkSplitOutput)
+{
+    const QString gmk = QFileInfo(gmkFileName).absoluteFilePath();
+    const QString output = QFileInfo(gmkSplitOutput).absoluteFilePath();
+
+    // The job line has no escaping
+    if (gmk.contains('\t') || gmk.contains('\n') || output.contains('\t') || output.contains('\n'))
+    {
+        return false;
+    }
+
+    Job job;
+    quint64 id = 0;
+
+    {
+        QMutexLocker locker(&workerMutex);
+
+        if (workerThreadCount == 0 || !start())
+        {
+            return false;
+        }
+
+        id = nextJobId++;
+        jobs.insert(id, &job);
+    }
+
+    const QByteArray line = QString("%1\t%2\t%3\n").arg(id).arg(gmk, output).toUtf8();
+
+    QMetaObject::invokeMethod(host, [line]()
+    {
+        process->write(line);
+    }, Qt::QueuedConnection);
+
+    job.done.acquire();
+
+    return job.ok;
+}
+
+void GmkSplitWorker::stop()
+{
+    QThread* thread = nullptr;
+    QObject* oldHost = nullptr;
+
+    {
+        QMutexLocker locker(&workerMutex);
+        thread = workerThread;
+        oldHost = host;
+
+        // Only a running worker has an exit to expect, otherwise the flag would stay for the next start
+        stopping = thread != nullptr;
+    }
+
+    if (!thread)
+    {
+        return;
+    }
+
+    // Not under the mutex, the finished handler takes it
+    QMetaObject::invokeMethod(oldHost, []()
+    {
+        if (process->state() != QProcess::NotRunning)
+        {
+            process->closeWriteChannel();
+            if (!process->waitForFinished(30000))
+            {
+                process->kill();
+                process->waitForFinished();
+            }
+        }
+
+        delete process;
+        process = nullptr;
+    }, Qt::BlockingQueuedConnection);
+
+    thread->quit();
+    thread->wait();
+
+    QMutexLocker locker(&workerMutex);
+
+    failJobs();
+
+    delete host;
+    host = nullptr;
+
+    delete workerThread;
+    workerThread = nullptr;
+
+    failed = false;
+    stopping = false;
+}
+
+QString GmkSplitWorker::javaFileName()
+{
+    const QString javaHome = qEnvironmentVariable("JAVA_HOME");
+    if (!javaHome.isEmpty())
+    {
+        const QString java = QStandardPaths::findExecutable("java", { javaHome + "/bin" });
+        if (!java.isEmpty())
+        {
+            return java;
+        }
+    }
+
+    return QStandardPaths::findExecutable("java");
+}
+
+QString GmkSplitWorker::jarFileName()
+{
+    return QCoreApplication::applicationDirPath() + "/GmkSplitter.v0.18/gmksplit.jar";
+}
+
+QString GmkSplitWorker::sourceFileName()
+{
+    // Installed next to gmksplit.jar, or taken from the source tree the program was built from
+    QStringList candidates = { QCoreApplication::applicationDirPath() + "/GmkSplitter.v0.18/GmkSplitWorker.java",
+                               QCoreApplication::applicationDirPath() + "/GmkSplitWorker.java" };
+#ifdef GMLH_MISC_DIR
+    candidates.append(QString::fromUtf8(GMLH_MISC_DIR) + "/GmkSplitWorker.java");
+#endif
+
+    for (const QString& candidate : candidates)
+    {
+        if (QFileInfo::exists(candidate))
+        {
+            return candidate;
+        }
+    }
+
+    return candidates.first();
+}
+
+bool GmkSplitWorker::start()
+{
+    // Called with workerMutex locked
+    if (failed)
+    {
+        return false;
+    }
+
+    if (workerThread)
+    {
+        return true;
+    }
+
+    if (!isAvailable())
+    {
+        failed = true;
+        return false;
+    }
+
+    workerThread = new QThread();
+    workerThread->start();
+
+    host = new QObject();
+    host->moveToThread(workerThread);
+
+    const QString java = javaFileName();
+    const QStringList arguments = { "-cp", jarFileName(), sourceFileName(), QString::number(workerThreadCount) };
+
+    bool started = false;
+
+    QMetaObject::invokeMethod(host, [&started, java, arguments]()
+    {
+        process = new QProcess();
+
+        QObject::connect(process, &QProcess::readyReadStandardOutput, host, &readAnswers);
+
+        QObject::connect(process, &QProcess::readyReadStandardError, host, []()
+        {
+            Logger::log(Severity::Debug, Event::Message, QString::fromUtf8(process->readAllStandardError()).trimmed());
+        });
+
+        QObject::connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), host, [](int exitCode, QProcess::ExitStatus)
+        {
+            // Not restarted until stop(), the remaining splits go the usual way
+            QMutexLocker locker(&workerMutex);
+
+            if (!stopping)
+            {
+                Logger::log(Severity::Warning, Event::GmkSplitWorkerFailed, QString("exit code %1").arg(exitCode));
+            }
+
+            failed = true;
+            failJobs();
+        });
+
+        process->start(java, arguments);
+        started = process->waitForStarted();
+    }, Qt::BlockingQueuedConnection);
+
+    if (!started)
+    {
+        Logger::log(Severity::Warning, Event::GmkSplitWorkerFailed, java);
+        failed = true;
+        return false;
+    }
+
+    Logger::log(Severity::Info, Event::GmkSplitWorkerStarted, workerThreadCount);
+
+    return true;
+}
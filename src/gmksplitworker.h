@@ -0,0 +1,29 @@
+#pragma once
+
+#include <QString>
+
+// gmksplit.jar loaded once in a JVM for a whole batch, splits are sent to it over stdin.
+// JVM startup and warmup are paid once instead of for every GMK.
+// GmkSplitter keeps static state, so one split runs at a time by default
+class GmkSplitWorker
+{
+public:
+    // Threads of the worker, 0 - the worker is not used (default)
+    static void setThreadCount(int count);
+    static int threadCount();
+
+    // Java, gmksplit.jar and GmkSplitWorker.java are found
+    static bool isAvailable();
+
+    // Starts the worker on first use. false - the worker could not split, gmksplit has to be run the usual way
+    static bool split(const QString& gmkFileName, const QString& gmkSplitOutput);
+
+    // Ends the worker, it is started again by the next split
+    static void stop();
+
+private:
+    static QString javaFileName();
+    static QString jarFileName();
+    static QString sourceFileName();
+    static bool start();
+};
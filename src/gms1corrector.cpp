@@ -1,146 +1,243 @@
 #include "gms1corrector.h"
+#include "iothrottle.h"
+#include "batchio.h"
+#include "dirwalker.h"
+#include "gmksplitcache.h"
+#include "gmksplitworker.h"
+#include "workspace.h"
+#include "snapshot.h"
+#include "fileutils.h"
+#include "logger.h"
 #include <QFileInfo>
 #include <QProcess>
 #include <QDir>
 #include <QCoreApplication>
-#include <QStandardPaths>
-#include <QDirIterator>
-#include <QDebug>
 #include <QDomDocument>
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
+#include <QSaveFile>
+#include <QCryptographicHash>
+#include <QtConcurrent>
 #include <thread>
+#include <algorithm>
 
 namespace
 {
 
-static std::function<void(const QString&)> logCallback = nullptr;
-void log(const QString &text)
+using Severity = Logger::Severity;
+using Event = Logger::Event;
+
+bool readFile(const QString& fileName, QByteArray& data)
 {
-    qDebug(text.toUtf8());
+    IoThrottle::Guard guard;
 
-    if (logCallback)
+    QFile file(fileName);
+    if (!file.open(QFile::ReadOnly | QFile::Text))
     {
-        logCallback(text);
+        Logger::log(Severity::Error, Event::FileReadFailed, fileName);
+        return false;
     }
+
+    data = file.readAll();
+
+    return true;
 }
 
-bool removeDir(QString dirName)
+FileUtils::Result writeFile(const QString& fileName, const QByteArray& data)
 {
-    bool result = true;
-    QDir dir(dirName);
-
-    if (dir.exists(dirName))
+    const FileUtils::Result result = FileUtils::writeIfChanged(fileName, data);
+    if (result == FileUtils::Result::Failed)
     {
-        Q_FOREACH(QFileInfo info, dir.entryInfoList(QDir::NoDotAndDotDot | QDir::System | QDir::Hidden  | QDir::AllDirs | QDir::Files, QDir::DirsFirst))
-        {
-            if (info.isDir())
-            {
-                result = removeDir(info.absoluteFilePath());
-            }
-            else
-            {
-                result = QFile::remove(info.absoluteFilePath());
-            }
-
-            if (!result)
-            {
-                return result;
-            }
-        }
-
-        result = dir.rmdir(dirName);
+        Logger::log(Severity::Error, Event::FileWriteFailed, fileName);
     }
 
     return result;
 }
 
-QString gms1EventTypeToGmk(const QString& type)
+// Categories written by gmksplit, in the order of the GameMaker event types
+static const QStringList GmkEventTypes =
+{
+    "CREATE",
+    "DESTROY",
+    "ALARM",
+    "STEP",
+    "COLLISION",
+    "KEYBOARD",
+    "MOUSE",
+    "OTHER",
+    "DRAW",
+    "KEYPRESS",
+    "KEYRELEASE",
+    "TRIGGER",
+};
+
+QString gms1EventTypeToGmk(int type)
 {
-    if (type == "0")
+    if (type < 0 || type >= GmkEventTypes.count())
     {
-        return "CREATE";
+        return QString();
     }
 
-    if (type == "1")
-    {
-        return "DESTROY";
-    }
+    return GmkEventTypes.at(type);
+}
 
-    if (type == "2")
+int gmkEventTypeToGms1(const QString& type)
+{
+    if (type.isEmpty())
     {
-        return "ALARM";
+        return -1;
     }
 
-    if (type == "3")
-    {
-        return "STEP";
-    }
+    return GmkEventTypes.indexOf(type);
+}
 
-    if (type == "4")
-    {
-        return "COLLISION";
-    }
+static qint64 maxRoomMemory = 256LL * 1024 * 1024;
+
+// Rough memory of a QDomDocument per byte of the XML file
+static const qint64 DomBytesPerFileByte = 10;
+
+static const qint64 MinChunkBytes = 64 * 1024;
+
+static const int ScriptsReadWindow = 512;
 
-    if (type == "5")
+QString codeHash(const QString& code)
+{
+    return QString::fromLatin1(QCryptographicHash::hash(code.toUtf8(), QCryptographicHash::Sha1).toHex().left(16));
+}
+
+// Equal code is in the pool under the same id, so hashes are only needed for a divergence and are computed once per block
+bool isSameCode(CodePool& pool, int sourceId, const QString& destCode, QString& sourceHash, QString& destHash)
+{
+    const int destId = pool.find(destCode);
+    if (destId == sourceId)
     {
-        return "KEYBOARD";
+        return true;
     }
 
-    if (type == "6")
+    sourceHash = pool.hash(sourceId);
+    destHash = destId >= 0 ? pool.hash(destId) : codeHash(destCode);
+
+    return false;
+}
+
+QJsonObject divergence(const QString& type, const QString& resource, const QString& name)
+{
+    QJsonObject object;
+    object.insert("type", type);
+    object.insert("resource", resource);
+    object.insert("name", name);
+
+    return object;
+}
+
+QJsonObject eventToJson(int type, int id, const QString& with)
+{
+    QJsonObject object;
+    object.insert("type", gms1EventTypeToGmk(type));
+    object.insert("id", id);
+    if (!with.isEmpty())
     {
-        //TODO:
+        object.insert("with", with);
     }
 
-    if (type == "7")
+    return object;
+}
+
+QJsonObject instanceToJson(const QString& objectName, qint64 x, qint64 y)
+{
+    QJsonObject object;
+    object.insert("object", objectName);
+    object.insert("x", x);
+    object.insert("y", y);
+
+    return object;
+}
+
+QJsonArray joinArrays(const QList<QJsonArray>& arrays)
+{
+    QJsonArray result;
+    for (const QJsonArray& array : arrays)
     {
-        return "OTHER";
+        for (const QJsonValue& value : array)
+        {
+            result.append(value);
+        }
     }
 
-    if (type == "8")
+    return result;
+}
+
+}
+
+uint qHash(const GMS1Corrector::EventKey &key, uint seed)
+{
+    return qHash(key.type, seed) ^ qHash(key.id, seed << 1) ^ qHash(key.with, seed << 2);
+}
+
+void GMS1Corrector::convertAnsiToUtf8(const QString &gmkFileName, const QString &gms1folder)
+{
+    if (!checkInput(gmkFileName, gms1folder))
     {
-        return "DRAW";
+        return;
     }
 
-    if (type == "9")
+    const Workspace workspace;
+    if (!workspace.isValid())
     {
-        return "KEYPRESS";
+        Logger::log(Severity::Error, Event::TempFolderNotFound);
+        return;
     }
 
-    if (type == "10")
+    const GmkSplitCache::Usage cacheUsage;
+
+    const QString gmkSplitOutput = splitGmkCached(gmkFileName, workspace.filePath("gmksplit_output"));
+    if (gmkSplitOutput.isEmpty())
     {
-        return "KEYRELEASE";
+        return;
     }
 
-    return QString();
-}
+    CodeStats codeStats;
 
-}
+    copyScripts(gmkSplitOutput, gms1folder);
+    correctObjectsCodes(gmkSplitOutput, gms1folder, codeStats);
+    correctRoomsCreationCode(gmkSplitOutput, gms1folder, codeStats);
 
-void GMS1Corrector::setLogCallback(std::function<void (const QString &)> callback)
-{
-    logCallback = callback;
+    logCodeStats(codeStats.stats());
+
+    Logger::log(Severity::Info, Event::Done);
 }
 
-void GMS1Corrector::convertAnsiToUtf8(const QString &gmkFileName, const QString &gms1folder)
+bool GMS1Corrector::checkGmkInput(const QString &gmkFileName)
 {
-    QFileInfo gmkSplit(QCoreApplication::applicationDirPath() + "/GmkSplitter.v0.18/gmksplit.exe");
+    QFileInfo gmkSplit(gmkSplitFileName());
     if (!gmkSplit.exists())
     {
-        log(QString("File \"%1\" not found").arg(gmkSplit.absoluteFilePath()));
-        return;
+        Logger::log(Severity::Error, Event::FileNotFound, gmkSplit.absoluteFilePath());
+        return false;
     }
 
     QFileInfo gmk(gmkFileName);
     if (!gmk.exists())
     {
-        log(QString("GMK file \"%1\" not found").arg(gmkFileName));
-        return;
+        Logger::log(Severity::Error, Event::FileNotFound, gmkFileName);
+        return false;
+    }
+
+    return true;
+}
+
+bool GMS1Corrector::checkInput(const QString &gmkFileName, const QString &gms1folder)
+{
+    if (!checkGmkInput(gmkFileName))
+    {
+        return false;
     }
 
     QDir root(gms1folder);
     if (!root.exists())
     {
-        log(QString("Folder \"%1\" not exists!").arg(gms1folder));
-        return;
+        Logger::log(Severity::Error, Event::FolderNotFound, gms1folder);
+        return false;
     }
 
     static const QString FileProjectSuffix = "GMX";
@@ -159,162 +256,335 @@ void GMS1Corrector::convertAnsiToUtf8(const QString &gmkFileName, const QString
 
     if (!foundProjectFile)
     {
-        log(QString("GMS1 Folder project does not contain a project file %1").arg(FileProjectSuffix));
-        return;
-    }
-
-    const QString temp = QStandardPaths::writableLocation(QStandardPaths::StandardLocation::TempLocation);
-    if (temp.isEmpty())
-    {
-        log("Writable temp directory not found");
-        return;
+        Logger::log(Severity::Error, Event::ProjectFileNotFound, "GMS1", FileProjectSuffix);
+        return false;
     }
 
-    const QString gmkSplitOutput = temp + "/gmksplit_output";
+    return true;
+}
 
-    log(QString("GmkSplit output: \"%1\"").arg(gmkSplitOutput));
+QString GMS1Corrector::gmkSplitFileName()
+{
+    return QCoreApplication::applicationDirPath() + "/GmkSplitter.v0.18/gmksplit.exe";
+}
 
-    if (!removeDir(gmkSplitOutput))
+bool GMS1Corrector::splitGmk(const QString &gmkFileName, const QString &gmkSplitOutput)
+{
+    // In a batch gmksplit stays loaded in one JVM
+    if (GmkSplitWorker::split(gmkFileName, gmkSplitOutput))
     {
-        log(QString("Problem deleting folder \"%1\"").arg(gmkSplitOutput));
+        Logger::log(Severity::Info, Event::GmkSplitFinished);
+        return true;
     }
 
+    // gmksplit does not write into an existing folder, a failed worker split may have left one
+    FileUtils::removeTree(gmkSplitOutput);
+
+    const QFileInfo gmkSplit(gmkSplitFileName());
+    const QFileInfo gmk(gmkFileName);
+
     QProcess process;
 
     QObject::connect(&process, &QProcess::readyRead, [&process]()
     {
-        log(process.readAll());
+        const QString output = QString::fromUtf8(process.readAll());
+        Logger::log(Severity::Info, Event::Message, output);
     });
 
     process.start(gmkSplit.absoluteFilePath(), { gmk.absoluteFilePath(), gmkSplitOutput });
 
-    log(QString("GmkSplit started (%1)").arg(gmkSplit.absoluteFilePath()));
+    // A process that did not start keeps NormalExit and exit code 0
+    if (!process.waitForStarted(-1))
+    {
+        Logger::log(Severity::Error, Event::GmkSplitNotStarted, gmkSplit.absoluteFilePath(), process.errorString());
+        return false;
+    }
+
+    Logger::log(Severity::Info, Event::GmkSplitStarted, gmkSplit.absoluteFilePath());
 
     process.waitForFinished(-1);
-    if (process.exitStatus() == QProcess::ExitStatus::CrashExit)
+
+    // A Java exception in the middle of the split exits normally with an error code and leaves partial output
+    if (process.exitStatus() == QProcess::ExitStatus::CrashExit || process.exitCode() != 0)
     {
-        log(QString("Failed to execute GmkSplit, exit code: %1").arg(process.exitCode()));
-        return;
+        Logger::log(Severity::Error, Event::GmkSplitFailed, process.exitCode());
+        return false;
     }
 
-    log("GmkSplit finished");
-
-    copyScripts(gmkSplitOutput, gms1folder);
-    correctObjectsCodes(gmkSplitOutput, gms1folder);
-    correctRoomsCreationCode(gmkSplitOutput, gms1folder);
+    Logger::log(Severity::Info, Event::GmkSplitFinished);
 
-    log("Done!");
+    return true;
 }
 
-void GMS1Corrector::copyScripts(const QString& gmkSplitOutput, const QString& gms1folder)
+QString GMS1Corrector::splitGmkCached(const QString &gmkFileName, const QString &fallbackOutput)
 {
-    QDirIterator it(gmkSplitOutput + "/Scripts", QStringList() << "*.gml", QDir::Files, QDirIterator::Subdirectories);
-    while (it.hasNext())
+    const QString key = GmkSplitCache::isEnabled() ? GmkSplitCache::key(gmkFileName, gmkSplitFileName()) : QString();
+    if (key.isEmpty())
     {
-        const QFileInfo sourceFile(it.next());
-        QFileInfo destFile(gms1folder + "/scripts/" + sourceFile.fileName());
-        if (!destFile.exists())
-        {
-            log(QString("Destination file \"%1\" not found").arg(destFile.absoluteFilePath()));
-            continue;
-        }
+        Logger::log(Severity::Info, Event::GmkSplitOutput, fallbackOutput);
 
-        if (destFile.exists() && !QFile::remove(destFile.absoluteFilePath()))
+        if (!FileUtils::removeTree(fallbackOutput))
         {
-            log(QString("Failed to remove file \"%1\"").arg(destFile.absoluteFilePath()));
+            Logger::log(Severity::Warning, Event::FolderDeleteFailed, fallbackOutput);
         }
 
-        if (QFile::copy(sourceFile.absoluteFilePath(), destFile.absoluteFilePath()))
+        if (!splitGmk(gmkFileName, fallbackOutput))
         {
-            log(QString("Corrected script code \"%1\"").arg(sourceFile.baseName()));
+            return QString();
         }
-        else
+
+        if (!QFileInfo(fallbackOutput).isDir())
         {
-            log(QString("Failed to copy \"%1\" to \"%2\"").arg(sourceFile.absoluteFilePath(), destFile.absoluteFilePath()));
+            Logger::log(Severity::Error, Event::GmkSplitNoOutput, fallbackOutput);
+            return QString();
         }
+
+        return fallbackOutput;
+    }
+
+    const QString cachedOutput = GmkSplitCache::find(key);
+    if (!cachedOutput.isEmpty())
+    {
+        Logger::log(Severity::Info, Event::GmkSplitCached, cachedOutput);
+        return cachedOutput;
+    }
+
+    const QString newOutput = GmkSplitCache::newEntryFolder(key);
+
+    Logger::log(Severity::Info, Event::GmkSplitOutput, newOutput);
+
+    if (!splitGmk(gmkFileName, newOutput))
+    {
+        FileUtils::removeTreeInBackground(newOutput);
+        return QString();
+    }
+
+    if (!QFileInfo(newOutput).isDir())
+    {
+        Logger::log(Severity::Error, Event::GmkSplitNoOutput, newOutput);
+        return QString();
+    }
+
+    const QString cachedNewOutput = GmkSplitCache::insert(key, newOutput);
+    if (cachedNewOutput.isEmpty())
+    {
+        Logger::log(Severity::Error, Event::GmkSplitNoOutput, GmkSplitCache::cacheFolder() + "/" + key);
     }
+
+    return cachedNewOutput;
+}
+
+QStringList GMS1Corrector::findScripts(const QString &gmkSplitOutput)
+{
+    return DirWalker::findFiles(gmkSplitOutput + "/Scripts", { ".gml" });
+}
+
+QStringList GMS1Corrector::findObjects(const QString &gmkSplitOutput)
+{
+    return DirWalker::findDirs(gmkSplitOutput + "/Objects", { ".events" });
+}
+
+QStringList GMS1Corrector::findRooms(const QString &gmkSplitOutput)
+{
+    QStringList result = DirWalker::findFiles(gmkSplitOutput + "/Rooms", { ".xml" });
+
+    result.erase(std::remove_if(result.begin(), result.end(), [](const QString& fileName)
+    {
+        return fileName.endsWith("/_resources.list.xml");
+    }), result.end());
+
+    return result;
 }
 
-void GMS1Corrector::correctObjectsCodes(const QString &gmkSplitOutput, const QString &gms1folder)
+void GMS1Corrector::copyScripts(const QString& gmkSplitOutput, const QString& gms1folder)
 {
-    QDirIterator objectsDirIt(gmkSplitOutput + "/Objects", QStringList() << "*.events", QDir::Filter::Dirs, QDirIterator::Subdirectories);
-    while (objectsDirIt.hasNext())
+    const QStringList sourceFileNames = findScripts(gmkSplitOutput);
+
+    // Both sides of a window of scripts are read in one batch, only the scripts that differ are copied
+    for (int begin = 0; begin < sourceFileNames.count(); begin += ScriptsReadWindow)
     {
-        const QDir objectDir(objectsDirIt.next());
-        const QString objectName = objectDir.dirName().left(objectDir.dirName().length() - 7);
+        const QStringList window = sourceFileNames.mid(begin, ScriptsReadWindow);
+
+        QStringList fileNames = window;
+        for (const QString& sourceFileName : window)
+        {
+            fileNames.append(gms1folder + "/scripts/" + QFileInfo(sourceFileName).fileName());
+        }
 
-        QList<SourceEvent> events;
+        const QVector<BatchIo::ReadResult> files = BatchIo::readFiles(fileNames, false);
 
-        const QFileInfoList eventsFiles = objectDir.entryInfoList(QDir::Filter::Files);
-        for (const QFileInfo& eventFile : eventsFiles)
+        for (int i = 0; i < window.count(); ++i)
         {
-            QFile sourceFile(eventFile.absoluteFilePath());
-            if (!sourceFile.open(QFile::OpenModeFlag::ReadOnly | QFile::OpenModeFlag::Text))
-            {
-                log(QString("Failed to open file \"%1\"").arg(eventFile.absoluteFilePath()));
-                continue;
-            }
+            const BatchIo::ReadResult& source = files.at(i);
+            const BatchIo::ReadResult& dest = files.at(window.count() + i);
 
-            QDomDocument sourceDom;
-            if (!sourceDom.setContent(&sourceFile))
+            if (source.ok && dest.ok && source.data == dest.data)
             {
-                log(QString("Failed to load DOM content from \"%1\"").arg(sourceFile.fileName()));
                 continue;
             }
 
-            const QDomNode event = sourceDom.namedItem("event");
+            copyScript(window.at(i), gms1folder);
+        }
+    }
+}
+
+bool GMS1Corrector::copyScript(const QString &sourceFileName, const QString &gms1folder)
+{
+    const QFileInfo sourceFile(sourceFileName);
+    QFileInfo destFile(gms1folder + "/scripts/" + sourceFile.fileName());
+    if (!destFile.exists())
+    {
+        Logger::log(Severity::Warning, Event::FileNotFound, destFile.absoluteFilePath());
+        return false;
+    }
+
+    switch (FileUtils::copyIfChanged(sourceFile.absoluteFilePath(), destFile.absoluteFilePath()))
+    {
+    case FileUtils::Result::Failed:
+        Logger::log(Severity::Error, Event::FileCopyFailed, sourceFile.absoluteFilePath(), destFile.absoluteFilePath());
+        return false;
 
-            SourceEvent sourceEvent(event.attributes().namedItem("category").nodeValue(),
-                                    event.attributes().namedItem("id").nodeValue(),
-                                    event.attributes().namedItem("with").nodeValue());
+    case FileUtils::Result::Unchanged:
+        return true;
 
-            const QDomNodeList actions = event.namedItem("actions").childNodes();
-            for (int i = 0; i < actions.count(); ++i)
-            {
-                const QDomNode action = actions.at(i);
-                if (action.namedItem("kind").firstChild().nodeValue() != "CODE")
-                {
-                    continue;
-                }
+    case FileUtils::Result::Changed:
+        Logger::log(Severity::Info, Event::ScriptCorrected, sourceFile.baseName());
+        return true;
+    }
+
+    return true;
+}
+
+void GMS1Corrector::correctObjectsCodes(const QString &gmkSplitOutput, const QString &gms1folder, CodeStats &codeStats)
+{
+    for (const QString& objectDirName : findObjects(gmkSplitOutput))
+    {
+        correctObject(objectDirName, gms1folder, codeStats);
+    }
+}
+
+bool GMS1Corrector::correctObject(const QString &objectDirName, const QString &gms1folder, CodeStats &codeStats)
+{
+    StringPool names;
+    CodePool codes;
+    const CodeStats::Scope codeStatsScope(codeStats, codes);
+
+    const QVector<SourceEvent> events = readSourceEvents(objectDirName, names, codes);
+
+    return correctObjectCodes(objectNameFromDir(objectDirName), gms1folder, events, names, codes);
+}
+
+QString GMS1Corrector::gmkEventTypeName(int type)
+{
+    return gms1EventTypeToGmk(type);
+}
+
+QString GMS1Corrector::objectNameFromDir(const QString &objectDirName)
+{
+    const QString dirName = QDir(objectDirName).dirName();
+
+    return dirName.left(dirName.length() - 7);
+}
+
+QVector<GMS1Corrector::SourceEvent> GMS1Corrector::readSourceEvents(const QString &objectDirName, StringPool &names, CodePool &codes)
+{
+    const QDir objectDir(objectDirName);
+
+    QStringList eventsFileNames;
+    for (const QFileInfo& eventFile : objectDir.entryInfoList(QDir::Filter::Files))
+    {
+        eventsFileNames.append(eventFile.absoluteFilePath());
+    }
+
+    // An object has a file per event, they are all read in one batch
+    const QVector<BatchIo::ReadResult> eventsFiles = BatchIo::readFiles(eventsFileNames, true);
+
+    QVector<SourceEvent> events;
+    events.reserve(eventsFiles.count());
+
+    for (int i = 0; i < eventsFiles.count(); ++i)
+    {
+        if (!eventsFiles.at(i).ok)
+        {
+            Logger::log(Severity::Error, Event::FileReadFailed, eventsFileNames.at(i));
+            continue;
+        }
+
+        QDomDocument sourceDom;
+        if (!sourceDom.setContent(eventsFiles.at(i).data))
+        {
+            Logger::log(Severity::Error, Event::DomLoadFailed, eventsFileNames.at(i));
+            continue;
+        }
+
+        const QDomNode event = sourceDom.namedItem("event");
+        const QDomNamedNodeMap attributes = event.attributes();
+
+        const QString category = attributes.namedItem("category").nodeValue();
+
+        SourceEvent sourceEvent;
+        sourceEvent.key.type = gmkEventTypeToGms1(category);
+        if (sourceEvent.key.type < 0)
+        {
+            Logger::log(Severity::Warning, Event::UnknownEventType, category, objectNameFromDir(objectDirName));
+            continue;
+        }
 
-                sourceEvent.codes.append(action.namedItem("arguments").childNodes().at(0).firstChild().nodeValue());
+        sourceEvent.key.id = attributes.namedItem("id").nodeValue().toInt();
+        sourceEvent.key.with = names.intern(attributes.namedItem("with").nodeValue());
+
+        const QDomNodeList actions = event.namedItem("actions").childNodes();
+        for (int i = 0; i < actions.count(); ++i)
+        {
+            const QDomNode action = actions.at(i);
+            if (action.namedItem("kind").firstChild().nodeValue() != "CODE")
+            {
+                continue;
             }
 
-            events.append(sourceEvent);
+            sourceEvent.codes.append(codes.intern(action.namedItem("arguments").childNodes().at(0).firstChild().nodeValue()));
         }
 
-        correctObjectCodes(objectName, gms1folder, events);
+        events.append(std::move(sourceEvent));
     }
+
+    return events;
 }
 
-void GMS1Corrector::correctObjectCodes(const QString &objectName, const QString& gms1folder, const QList<SourceEvent> &sourceEvents)
+bool GMS1Corrector::correctObjectCodes(const QString &objectName, const QString& gms1folder, const QVector<SourceEvent> &sourceEvents, StringPool& names, CodePool& codes)
 {
     if (sourceEvents.isEmpty())
     {
-        return;
+        return true;
+    }
+
+    QHash<EventKey, int> sourceEventsIndex;
+    sourceEventsIndex.reserve(sourceEvents.count());
+    for (int i = 0; i < sourceEvents.count(); ++i)
+    {
+        sourceEventsIndex.insert(sourceEvents.at(i).key, i);
     }
 
     bool needSaveFile = false;
 
     const QString destFileName = gms1folder + "/objects/" + objectName + ".object.gmx";
-    QFile destFileRead(destFileName);
-    if (!destFileRead.exists())
+    if (!QFile::exists(destFileName))
     {
-        log(QString("File \"%1\" not found").arg(destFileName));
-        return;
+        Logger::log(Severity::Warning, Event::FileNotFound, destFileName);
+        return false;
     }
 
-    if (!destFileRead.open(QFile::ReadOnly | QFile::Text))
+    QByteArray destData;
+    if (!readFile(destFileName, destData))
     {
-        log(QString("Failed to open file \"%1\" for read").arg(destFileName));
-        return;
+        return false;
     }
 
     QDomDocument dom;
-    if (!dom.setContent(&destFileRead))
+    if (!dom.setContent(destData))
     {
-        log(QString("Failed to load DOM content from \"%1\"").arg(destFileName));
-        return;
+        Logger::log(Severity::Error, Event::DomLoadFailed, destFileName);
+        return false;
     }
 
     const QDomNodeList events = dom.namedItem("object").namedItem("events").childNodes();
@@ -322,33 +592,30 @@ void GMS1Corrector::correctObjectCodes(const QString &objectName, const QString&
     for (int i = 0; i < events.count(); ++i)
     {
         const QDomNode event = events.at(i);
+        const QDomNamedNodeMap attributes = event.attributes();
 
-        const QString destEventType = event.attributes().namedItem("eventtype").nodeValue();
-        const QString destEventId = event.attributes().namedItem("enumb").nodeValue();
-        const QString destEventWith = event.attributes().namedItem("ename").nodeValue();
-
-        if (gms1EventTypeToGmk(destEventType).isEmpty())
-        {
-            log(QString("Unknown event type \"%1\" in object \"%2\"").arg(destEventType, objectName));
-            continue;
-        }
+        const QString destEventType = attributes.namedItem("eventtype").nodeValue();
 
-        const SourceEvent* sourceEvent = nullptr;
+        EventKey destKey;
+        destKey.type = destEventType.toInt();
+        destKey.id = attributes.namedItem("enumb").nodeValue().toInt();
+        destKey.with = names.intern(attributes.namedItem("ename").nodeValue());
 
-        for (const SourceEvent& sourceEvent_ : sourceEvents)
+        if (gms1EventTypeToGmk(destKey.type).isEmpty())
         {
-            if (gms1EventTypeToGmk(destEventType) == sourceEvent_.type && destEventId == sourceEvent_.id && destEventWith == sourceEvent_.with)
-            {
-                sourceEvent = &sourceEvent_;
-            }
+            Logger::log(Severity::Warning, Event::UnknownEventType, destEventType, objectName);
+            continue;
         }
 
-        if (!sourceEvent)
+        const auto sourceEventIt = sourceEventsIndex.constFind(destKey);
+        if (sourceEventIt == sourceEventsIndex.constEnd())
         {
-            log(QString("Not found GM7/8 event for GMS1 event \"%1\" (%2) in object \"%3\"").arg(destEventType, destEventType, objectName));
+            Logger::log(Severity::Warning, Event::EventNotFound, destEventType, destEventType, objectName);
             continue;
         }
 
+        const SourceEvent* sourceEvent = &sourceEvents.at(sourceEventIt.value());
+
         int sourceCodeIndex = 0;
         int destCodes = 0;
         const QDomNodeList actionNodes = event.childNodes();
@@ -373,162 +640,923 @@ void GMS1Corrector::correctObjectCodes(const QString &objectName, const QString&
 
             if (sourceCodeIndex >= sourceEvent->codes.count())
             {
-                log(QString("Fewer GM7/8 codes than GMS1 codes in event \"%1\" (%2) in object \"%3\"").arg(destEventType, destEventType, objectName));
+                Logger::log(Severity::Warning, Event::FewerCodes, destEventType, destEventType, objectName);
                 continue;
             }
 
-            codeNode.setNodeValue(sourceEvent->codes.at(sourceCodeIndex));
-
-            needSaveFile = true;
+            const QString sourceCode = codes.code(sourceEvent->codes.at(sourceCodeIndex));
+            if (codeNode.nodeValue() != sourceCode)
+            {
+                codeNode.setNodeValue(sourceCode);
+                needSaveFile = true;
+            }
 
             sourceCodeIndex++;
         }
 
         if (destCodes != sourceEvent->codes.count())
         {
-            log(QString("The number of GM7/8 codes (%1) does not match the number of GMS1 codes (%2) in object \"%3\", event: %4 (%5)")
-                .arg(sourceEvent->codes.count()).arg(destCodes).arg(objectName, sourceEvent->type, destEventType));
+            Logger::log(Severity::Warning, Event::CodeCountMismatch,
+                        sourceEvent->codes.count(), destCodes, objectName, gms1EventTypeToGmk(sourceEvent->key.type), destEventType);
         }
     }
 
     if (needSaveFile)
     {
-        destFileRead.close();
+        const FileUtils::Result result = writeFile(destFileName, dom.toString().toUtf8());
+        if (result == FileUtils::Result::Failed)
+        {
+            return false;
+        }
 
-        QFile destFileWrite(destFileName);
-        if (!destFileWrite.open(QFile::WriteOnly | QFile::Text | QFile::Truncate))
+        if (result == FileUtils::Result::Changed)
         {
-            log(QString("Failed to open file \"%1\" for write").arg(destFileName));
-            return;
+            Logger::log(Severity::Info, Event::ObjectCorrected, objectName);
         }
+    }
 
-        destFileWrite.write(dom.toString().toUtf8());
+    return true;
+}
 
-        log(QString("Corrected object code \"%1\"").arg(objectName));
+void GMS1Corrector::correctRoomsCreationCode(const QString &gmkSplitOutput, const QString &gms1folder, CodeStats &codeStats)
+{
+    for (const QString& sourceFileName : findRooms(gmkSplitOutput))
+    {
+        correctRoom(sourceFileName, gms1folder, codeStats);
     }
 }
 
-void GMS1Corrector::correctRoomsCreationCode(const QString &gmkSplitOutput, const QString &gms1folder)
+bool GMS1Corrector::correctRoom(const QString &sourceFileName, const QString &gms1folder, CodeStats &codeStats)
 {
-    QDirIterator roomsDirIt(gmkSplitOutput + "/Rooms", QStringList() << "*.xml", QDir::Filter::Files, QDirIterator::Subdirectories);
-    while (roomsDirIt.hasNext())
-    {
-        const QString sourceFileName = roomsDirIt.next();
-        const QFileInfo sourceRoomFileInfo(sourceFileName);
-        if (sourceRoomFileInfo.fileName() == "_resources.list.xml")
-        {
-            continue;
-        }
+    const QFileInfo sourceRoomFileInfo(sourceFileName);
+    const QString roomName = sourceRoomFileInfo.fileName().left(sourceRoomFileInfo.fileName().length() - 4);
 
-        const QString roomName = sourceRoomFileInfo.fileName().left(sourceRoomFileInfo.fileName().length() - 4);
-        QFile sourceFile(sourceFileName);
-        if (!sourceFile.open(QFile::ReadOnly | QFile::Text))
-        {
-            log(QString("Failed to open file \"%1\" for read").arg(sourceFileName));
-            return;
-        }
+    const QString destFileName = gms1folder + "/rooms/" + roomName + ".room.gmx";
 
-        QDomDocument sourceDom;
-        if (!sourceDom.setContent(&sourceFile))
-        {
-            log(QString("Failed to load DOM content from \"%1\"").arg(sourceFile.fileName()));
-            continue;
-        }
+    if (maxRoomMemory > 0 && (sourceRoomFileInfo.size() + QFileInfo(destFileName).size()) * DomBytesPerFileByte > maxRoomMemory)
+    {
+        return correctRoomStreaming(sourceFileName, destFileName, roomName);
+    }
 
-        const QString code = sourceDom.namedItem("room").namedItem("creationCode").firstChild().nodeValue();
+    CodePool codes;
+    const CodeStats::Scope codeStatsScope(codeStats, codes);
 
-        QList<Instance> instances;
+    return correctRoomDom(sourceFileName, destFileName, roomName, codes);
+}
 
-        const QDomNodeList domInstances = sourceDom.namedItem("room").namedItem("instances").childNodes();
-        for (int i = 0; i < domInstances.count(); ++i)
-        {
-            const QDomNode domInstance = domInstances.at(i);
+bool GMS1Corrector::correctRoomDom(const QString &sourceFileName, const QString &destFileName, const QString &roomName, CodePool &codes)
+{
+    StringPool names;
+    QString code;
+    QVector<Instance> instances;
 
-            Instance instance;
+    if (!readSourceRoom(sourceFileName, names, codes, code, instances))
+    {
+        return false;
+    }
 
-            instance.objectName = domInstance.namedItem("object").firstChild().nodeValue();
-            instance.x = domInstance.namedItem("position").attributes().namedItem("x").nodeValue().toLongLong();
-            instance.y = domInstance.namedItem("position").attributes().namedItem("y").nodeValue().toLongLong();
-            instance.creationCode = domInstance.namedItem("creationCode").firstChild().nodeValue();
+    QByteArray destData;
+    if (!readFile(destFileName, destData))
+    {
+        return false;
+    }
 
-            instances.append(instance);
-        }
+    QDomDocument destDom;
+    if (!destDom.setContent(destData))
+    {
+        Logger::log(Severity::Error, Event::DomLoadFailed, destFileName);
+        return false;
+    }
 
-        const QString destFileName = gms1folder + "/rooms/" + roomName + ".room.gmx";
+    destData.clear();
 
-        QFile destFileRead(destFileName);
-        if (!destFileRead.open(QFile::ReadOnly | QFile::Text))
-        {
-            log(QString("Failed to open file \"%1\" for read").arg(destFileName));
-            return;
-        }
+    QVector<Logger::Record> msgs;
 
-        QDomDocument destDom;
-        if (!destDom.setContent(&destFileRead))
-        {
-            log(QString("Failed to load DOM content from \"%1\"").arg(destFileRead.fileName()));
-            continue;
-        }
+    bool needSaveFile = false;
 
-        QStringList msgs;
+    QDomNode roomNode = destDom.namedItem("room");
 
-        QDomNode roomNode = destDom.namedItem("room");
-        roomNode.namedItem("code").firstChild().setNodeValue(code);
+    QDomNode destRoomCodeNode = roomNode.namedItem("code").firstChild();
+    if (destRoomCodeNode.nodeValue() != code)
+    {
+        destRoomCodeNode.setNodeValue(code);
+        needSaveFile = true;
+    }
 
-        QDomNodeList destInstancesNodes = roomNode.namedItem("instances").childNodes();
+    QDomNodeList destInstancesNodes = roomNode.namedItem("instances").childNodes();
 
-        if (instances.count() != destInstancesNodes.count())
-        {
-            log(QString("The number of instances in projects GM7/8 (count: %1) and GMS1 (count: %2) does not match in room \"%3\"")
-                .arg(instances.count()).arg(destInstancesNodes.count()).arg(roomName));
-        }
+    if (instances.count() != destInstancesNodes.count())
+    {
+        Logger::log(Severity::Warning, Event::InstanceCountMismatch, instances.count(), destInstancesNodes.count(), roomName);
+    }
 
-        for (int i = 0; i < std::min(destInstancesNodes.count(), instances.count()); ++i)
+    for (int i = 0; i < std::min(destInstancesNodes.count(), instances.count()); ++i)
+    {
+        QDomNamedNodeMap attributes = destInstancesNodes.at(i).attributes();
+
+        QDomNode destCodeNode = attributes.namedItem("code");
+        if (destCodeNode.nodeValue().isEmpty())
         {
-            QDomNamedNodeMap attributes = destInstancesNodes.at(i).attributes();
+            continue;
+        }
+
+        Instance destInstance;
+
+        destInstance.objectName = names.intern(attributes.namedItem("objName").nodeValue());
+        destInstance.x = attributes.namedItem("x").nodeValue().toLongLong();
+        destInstance.y = attributes.namedItem("y").nodeValue().toLongLong();
 
-            QDomNode destCodeNode = attributes.namedItem("code");
-            if (destCodeNode.nodeValue().isEmpty())
+        const Instance& sourceInstance = instances.at(i);
+
+        if (destInstance.isSameInstance(sourceInstance))
+        {
+            const QString sourceCode = codes.code(sourceInstance.creationCode);
+            if (destCodeNode.nodeValue() == sourceCode)
             {
                 continue;
             }
 
-            Instance destInstance;
+            destCodeNode.setNodeValue(sourceCode);
+            needSaveFile = true;
+
+            Logger::append(msgs, Severity::Info, Event::InstanceCorrected,
+                           names.string(destInstance.objectName), qint64(destInstance.x), qint64(destInstance.y), roomName);
+        }
+        else
+        {
+            Logger::append(msgs, Severity::Warning, Event::InstanceMismatch,
+                           i, names.string(sourceInstance.objectName), qint64(sourceInstance.x), qint64(sourceInstance.y),
+                           names.string(destInstance.objectName), qint64(destInstance.x), qint64(destInstance.y), roomName);
+        }
+    }
+
+    if (needSaveFile)
+    {
+        const FileUtils::Result result = writeFile(destFileName, destDom.toString().toUtf8());
+        if (result == FileUtils::Result::Failed)
+        {
+            return false;
+        }
+
+        if (result == FileUtils::Result::Changed)
+        {
+            Logger::append(msgs, Severity::Info, Event::RoomCorrected, roomName);
+        }
+    }
+
+    for (const Logger::Record& msg : msgs)
+    {
+        Logger::write(msg);
+    }
+
+    return true;
+}
+
+void GMS1Corrector::setRoomMemoryCap(qint64 bytes)
+{
+    maxRoomMemory = std::max<qint64>(bytes, 0);
+}
 
-            destInstance.objectName = attributes.namedItem("objName").nodeValue();
-            destInstance.x = attributes.namedItem("x").nodeValue().toLongLong();
-            destInstance.y = attributes.namedItem("y").nodeValue().toLongLong();
+qint64 GMS1Corrector::roomMemoryCap()
+{
+    return maxRoomMemory;
+}
 
-            const Instance sourceInstance = instances.at(i);
+void GMS1Corrector::logCodeStats(const CodePool::Stats& stats)
+{
+    Logger::log(Severity::Info, Event::CodeStats, stats.blocks, stats.uniqueBlocks, stats.duplicateBytes);
+}
 
-            if (destInstance.isSameInstance(sourceInstance))
+// Reads the instances of a GM7/8 room one chunk at a time, a chunk takes at most chunkBytes
+class GMS1Corrector::SourceInstanceReader
+{
+public:
+    SourceInstanceReader(QIODevice* device, StringPool& names_, qint64 chunkBytes_)
+        : reader(device)
+        , names(names_)
+        , chunkBytes(chunkBytes_)
+    {
+    }
+
+    bool next(Instance& instance)
+    {
+        if (chunkPosition >= chunk.count() && !readChunk())
+        {
+            return false;
+        }
+
+        instance = std::move(chunk[chunkPosition++]);
+
+        return true;
+    }
+
+    bool hasError() const
+    {
+        return reader.hasError();
+    }
+
+    // Valid until the next chunk is read
+    QString code(int id) const
+    {
+        return codes.code(id);
+    }
+
+private:
+    bool readChunk()
+    {
+        // The previous chunk is used up, its codes are not needed anymore
+        chunk.clear();
+        codes.clear();
+        chunkPosition = 0;
+
+        qint64 usedBytes = 0;
+
+        while (!finished && usedBytes < chunkBytes)
+        {
+            if (!inInstances)
             {
-                destCodeNode.setNodeValue(sourceInstance.creationCode);
+                if (reader.atEnd())
+                {
+                    finished = true;
+                    break;
+                }
+
+                const QXmlStreamReader::TokenType token = reader.readNext();
+                if (token == QXmlStreamReader::StartElement)
+                {
+                    depth++;
+
+                    if (depth == 2 && reader.name() == QLatin1String("instances"))
+                    {
+                        inInstances = true;
+                    }
+                }
+                else if (token == QXmlStreamReader::EndElement)
+                {
+                    depth--;
+                }
+                else if (token == QXmlStreamReader::Invalid)
+                {
+                    finished = true;
+                }
+
+                continue;
+            }
+
+            if (!reader.readNextStartElement())
+            {
+                // A room has only one list of instances
+                finished = true;
+                break;
+            }
+
+            if (reader.name() != QLatin1String("instance"))
+            {
+                reader.skipCurrentElement();
+                continue;
+            }
+
+            Instance instance;
+            const qint64 codeBytes = readInstance(instance);
+
+            // Duplicates share the text, but each one is counted, so the chunk stays below the cap anyway
+            usedBytes += qint64(sizeof(Instance)) + codeBytes;
+
+            chunk.append(std::move(instance));
+        }
+
+        return !chunk.isEmpty();
+    }
 
-                msgs.append(QString("Corrected instance creation code %1 in room \"%2\"").arg(destInstance.getInfoString(), roomName));
+    // Returns the size of the creation code
+    qint64 readInstance(Instance& instance)
+    {
+        qint64 codeBytes = 0;
+
+        while (reader.readNextStartElement())
+        {
+            if (reader.name() == QLatin1String("object"))
+            {
+                instance.objectName = names.intern(reader.readElementText());
+            }
+            else if (reader.name() == QLatin1String("position"))
+            {
+                instance.x = reader.attributes().value("x").toLongLong();
+                instance.y = reader.attributes().value("y").toLongLong();
+                reader.skipCurrentElement();
+            }
+            else if (reader.name() == QLatin1String("creationCode"))
+            {
+                const QString creationCode = reader.readElementText();
+                codeBytes += creationCode.size() * qint64(sizeof(QChar));
+                instance.creationCode = codes.intern(creationCode);
             }
             else
             {
-                msgs.append(QString("At index %1 found %2 but need %3 in room \"%4\"").arg(i).arg(sourceInstance.getInfoString(), destInstance.getInfoString(), roomName));
+                reader.skipCurrentElement();
             }
         }
 
-        destFileRead.close();
+        return codeBytes;
+    }
+
+    QXmlStreamReader reader;
+    StringPool& names;
+    const qint64 chunkBytes;
+
+    QVector<Instance> chunk;
+    CodePool codes; // codes of the chunk, the code pool of the room would grow with it
+    int chunkPosition = 0;
+    int depth = 0;
+    bool inInstances = false;
+    bool finished = false;
+};
+
+bool GMS1Corrector::correctRoomStreaming(const QString &sourceFileName, const QString &destFileName, const QString &roomName)
+{
+    QString code;
+    if (!readSourceRoomCode(sourceFileName, code))
+    {
+        return false;
+    }
+
+    IoThrottle::Guard guard;
+
+    QFile sourceFile(sourceFileName);
+    if (!sourceFile.open(QFile::ReadOnly))
+    {
+        Logger::log(Severity::Error, Event::FileReadFailed, sourceFileName);
+        return false;
+    }
+
+    QFile destFile(destFileName);
+    if (!destFile.open(QFile::ReadOnly))
+    {
+        Logger::log(Severity::Error, Event::FileReadFailed, destFileName);
+        return false;
+    }
+
+    // The result goes straight to the file and is thrown away if no value changed
+    QSaveFile outFile(destFileName);
+    if (!outFile.open(QFile::WriteOnly))
+    {
+        Logger::log(Severity::Error, Event::FileWriteFailed, destFileName);
+        return false;
+    }
+
+    StringPool names;
+    SourceInstanceReader sourceInstances(&sourceFile, names, std::max(maxRoomMemory / 4, MinChunkBytes));
+
+    QXmlStreamReader reader(&destFile);
+    QXmlStreamWriter writer(&outFile);
+
+    // Messages are written as they come, collecting them would grow with the room
+    bool changed = false;
+    bool inRoomCode = false;
+    bool inInstances = false;
+    QString destCode;
+    int depth = 0;
+    int destCount = 0;
+    int sourceCount = 0;
 
-        QFile destFileWrite(destFileName);
-        if (!destFileWrite.open(QFile::WriteOnly | QFile::Text | QFile::Truncate))
+    while (!reader.atEnd())
+    {
+        const QXmlStreamReader::TokenType token = reader.readNext();
+        if (token == QXmlStreamReader::Invalid)
         {
-            log(QString("Failed to open file \"%1\" for write").arg(destFileName));
-            return;
+            break;
         }
 
-        destFileWrite.write(destDom.toString().toUtf8());
+        if (inRoomCode)
+        {
+            if (token == QXmlStreamReader::Characters)
+            {
+                destCode += reader.text();
+                continue;
+            }
+
+            if (token == QXmlStreamReader::EndElement)
+            {
+                depth--;
+                inRoomCode = false;
 
-        msgs.append(QString("Corrected room creation code \"%1\"").arg(roomName));
+                if (destCode != code)
+                {
+                    changed = true;
+                }
 
-        for (const QString& msg : msgs)
+                writer.writeCharacters(code);
+                writer.writeEndElement();
+                continue;
+            }
+        }
+
+        if (token == QXmlStreamReader::StartElement)
         {
-            log(msg);
+            depth++;
+
+            if (depth == 2 && reader.name() == QLatin1String("code"))
+            {
+                writer.writeCurrentToken(reader);
+                inRoomCode = true;
+                destCode.clear();
+                continue;
+            }
+
+            if (depth == 2 && reader.name() == QLatin1String("instances"))
+            {
+                inInstances = true;
+            }
+
+            if (depth == 3 && inInstances && reader.name() == QLatin1String("instance"))
+            {
+                const int index = destCount++;
+
+                Instance sourceInstance;
+                const bool hasSource = sourceInstances.next(sourceInstance);
+                if (hasSource)
+                {
+                    sourceCount++;
+                }
+
+                QXmlStreamAttributes attributes = reader.attributes();
+                const QString destInstanceCode = attributes.value("code").toString();
+
+                if (hasSource && !destInstanceCode.isEmpty())
+                {
+                    Instance destInstance;
+                    destInstance.objectName = names.intern(attributes.value("objName").toString());
+                    destInstance.x = attributes.value("x").toLongLong();
+                    destInstance.y = attributes.value("y").toLongLong();
+
+                    if (destInstance.isSameInstance(sourceInstance))
+                    {
+                        const QString sourceCode = sourceInstances.code(sourceInstance.creationCode);
+                        if (destInstanceCode != sourceCode)
+                        {
+                            QXmlStreamAttributes newAttributes;
+                            for (const QXmlStreamAttribute& attribute : attributes)
+                            {
+                                newAttributes.append(attribute.qualifiedName().toString(),
+                                                     attribute.name() == QLatin1String("code") ? sourceCode : attribute.value().toString());
+                            }
+
+                            attributes = newAttributes;
+                            changed = true;
+
+                            Logger::log(Severity::Info, Event::InstanceCorrected,
+                                        names.string(destInstance.objectName), qint64(destInstance.x), qint64(destInstance.y), roomName);
+                        }
+                    }
+                    else
+                    {
+                        Logger::log(Severity::Warning, Event::InstanceMismatch,
+                                    index, names.string(sourceInstance.objectName), qint64(sourceInstance.x), qint64(sourceInstance.y),
+                                    names.string(destInstance.objectName), qint64(destInstance.x), qint64(destInstance.y), roomName);
+                    }
+                }
+
+                writer.writeStartElement(reader.qualifiedName().toString());
+                writer.writeAttributes(attributes);
+                continue;
+            }
+        }
+        else if (token == QXmlStreamReader::EndElement)
+        {
+            if (depth == 2)
+            {
+                inInstances = false;
+            }
+
+            depth--;
         }
+
+        writer.writeCurrentToken(reader);
+    }
+
+    if (reader.hasError())
+    {
+        Logger::log(Severity::Error, Event::DomLoadFailed, destFileName);
+        outFile.cancelWriting();
+        return false;
     }
+
+    Instance sourceInstance;
+    while (sourceInstances.next(sourceInstance))
+    {
+        sourceCount++;
+    }
+
+    if (sourceInstances.hasError())
+    {
+        Logger::log(Severity::Error, Event::DomLoadFailed, sourceFileName);
+        outFile.cancelWriting();
+        return false;
+    }
+
+    if (sourceCount != destCount)
+    {
+        Logger::log(Severity::Warning, Event::InstanceCountMismatch, sourceCount, destCount, roomName);
+    }
+
+    if (!changed)
+    {
+        outFile.cancelWriting();
+        return true;
+    }
+
+    Snapshot::preserve(destFileName);
+
+    if (!outFile.commit())
+    {
+        Logger::log(Severity::Error, Event::FileWriteFailed, destFileName);
+        return false;
+    }
+
+    Logger::log(Severity::Info, Event::RoomCorrected, roomName);
+
+    return true;
+}
+
+bool GMS1Corrector::readSourceRoomCode(const QString &sourceFileName, QString &code)
+{
+    IoThrottle::Guard guard;
+
+    QFile file(sourceFileName);
+    if (!file.open(QFile::ReadOnly))
+    {
+        Logger::log(Severity::Error, Event::FileReadFailed, sourceFileName);
+        return false;
+    }
+
+    code.clear();
+
+    // Everything except the room code is skipped without being kept
+    QXmlStreamReader reader(&file);
+    if (reader.readNextStartElement() && reader.name() == QLatin1String("room"))
+    {
+        while (reader.readNextStartElement())
+        {
+            if (reader.name() == QLatin1String("creationCode"))
+            {
+                code = reader.readElementText();
+                break;
+            }
+
+            reader.skipCurrentElement();
+        }
+    }
+
+    if (reader.hasError())
+    {
+        Logger::log(Severity::Error, Event::DomLoadFailed, sourceFileName);
+        return false;
+    }
+
+    return true;
+}
+
+bool GMS1Corrector::readSourceRoom(const QString &sourceFileName, StringPool &names, CodePool &codes, QString &code, QVector<Instance> &instances)
+{
+    QByteArray sourceData;
+    if (!readFile(sourceFileName, sourceData))
+    {
+        return false;
+    }
+
+    QDomDocument sourceDom;
+    if (!sourceDom.setContent(sourceData))
+    {
+        Logger::log(Severity::Error, Event::DomLoadFailed, sourceFileName);
+        return false;
+    }
+
+    sourceData.clear();
+
+    code = sourceDom.namedItem("room").namedItem("creationCode").firstChild().nodeValue();
+
+    const QDomNodeList domInstances = sourceDom.namedItem("room").namedItem("instances").childNodes();
+
+    instances.clear();
+    instances.reserve(domInstances.count());
+
+    for (int i = 0; i < domInstances.count(); ++i)
+    {
+        const QDomNode domInstance = domInstances.at(i);
+
+        Instance instance;
+
+        instance.objectName = names.intern(domInstance.namedItem("object").firstChild().nodeValue());
+        instance.x = domInstance.namedItem("position").attributes().namedItem("x").nodeValue().toLongLong();
+        instance.y = domInstance.namedItem("position").attributes().namedItem("y").nodeValue().toLongLong();
+        instance.creationCode = codes.intern(domInstance.namedItem("creationCode").firstChild().nodeValue());
+
+        instances.append(std::move(instance));
+    }
+
+    return true;
+}
+
+QJsonObject GMS1Corrector::audit(const QString &gmkFileName, const QString &gms1folder, CodeStats &codeStats)
+{
+    QJsonObject report;
+    report.insert("gmk", gmkFileName);
+    report.insert("gms1", gms1folder);
+
+    if (!checkInput(gmkFileName, gms1folder))
+    {
+        report.insert("error", "Invalid input");
+        return report;
+    }
+
+    const Workspace workspace;
+
+    const QString gmkSplitOutput = splitGmkCached(gmkFileName, workspace.filePath("gmksplit_output"));
+    if (gmkSplitOutput.isEmpty())
+    {
+        report.insert("error", "GmkSplit failed");
+        return report;
+    }
+
+    const QStringList scripts = findScripts(gmkSplitOutput);
+    const QStringList objects = findObjects(gmkSplitOutput);
+    const QStringList rooms = findRooms(gmkSplitOutput);
+
+    QJsonArray divergences;
+
+    const QJsonArray scriptDivergences = joinArrays(QtConcurrent::blockingMapped<QList<QJsonArray>>(scripts, [&gms1folder](const QString& fileName)
+    {
+        return auditScript(fileName, gms1folder);
+    }));
+
+    const QJsonArray objectDivergences = joinArrays(QtConcurrent::blockingMapped<QList<QJsonArray>>(objects, [&gms1folder, &codeStats](const QString& dirName)
+    {
+        return auditObject(dirName, gms1folder, codeStats);
+    }));
+
+    const QJsonArray roomDivergences = joinArrays(QtConcurrent::blockingMapped<QList<QJsonArray>>(rooms, [&gms1folder, &codeStats](const QString& fileName)
+    {
+        return auditRoom(fileName, gms1folder, codeStats);
+    }));
+
+    for (const QJsonArray& array : { scriptDivergences, objectDivergences, roomDivergences })
+    {
+        for (const QJsonValue& value : array)
+        {
+            divergences.append(value);
+        }
+    }
+
+    QJsonObject counts;
+    for (const QJsonValue& value : divergences)
+    {
+        const QString type = value.toObject().value("type").toString();
+        counts.insert(type, counts.value(type).toInt() + 1);
+    }
+
+    report.insert("scripts", scripts.count());
+    report.insert("objects", objects.count());
+    report.insert("rooms", rooms.count());
+    report.insert("divergenceCount", divergences.count());
+    report.insert("divergenceTypes", counts);
+    report.insert("divergences", divergences);
+
+    return report;
+}
+
+QJsonArray GMS1Corrector::auditScript(const QString &sourceFileName, const QString &gms1folder)
+{
+    QJsonArray result;
+
+    const QString scriptName = QFileInfo(sourceFileName).completeBaseName();
+    const QString destFileName = gms1folder + "/scripts/" + QFileInfo(sourceFileName).fileName();
+
+    if (!QFile::exists(destFileName))
+    {
+        result.append(divergence("missingInGms1", "script", scriptName));
+        return result;
+    }
+
+    IoThrottle::Guard guard;
+
+    if (!FileUtils::isSameContent(sourceFileName, destFileName))
+    {
+        result.append(divergence("scriptDiffers", "script", scriptName));
+    }
+
+    return result;
+}
+
+QJsonArray GMS1Corrector::auditObject(const QString &objectDirName, const QString &gms1folder, CodeStats &codeStats)
+{
+    QJsonArray result;
+
+    StringPool names;
+    CodePool codes;
+    const CodeStats::Scope codeStatsScope(codeStats, codes);
+
+    const QString objectName = objectNameFromDir(objectDirName);
+    const QVector<SourceEvent> sourceEvents = readSourceEvents(objectDirName, names, codes);
+
+    const QString destFileName = gms1folder + "/objects/" + objectName + ".object.gmx";
+    if (!QFile::exists(destFileName))
+    {
+        result.append(divergence("missingInGms1", "object", objectName));
+        return result;
+    }
+
+    QByteArray destData;
+    QDomDocument dom;
+    if (!readFile(destFileName, destData) || !dom.setContent(destData))
+    {
+        result.append(divergence("unreadable", "object", objectName));
+        return result;
+    }
+
+    QHash<EventKey, int> sourceEventsIndex;
+    sourceEventsIndex.reserve(sourceEvents.count());
+    for (int i = 0; i < sourceEvents.count(); ++i)
+    {
+        sourceEventsIndex.insert(sourceEvents.at(i).key, i);
+    }
+
+    QVector<bool> matched(sourceEvents.count(), false);
+
+    const QDomNodeList events = dom.namedItem("object").namedItem("events").childNodes();
+    for (int i = 0; i < events.count(); ++i)
+    {
+        const QDomNode event = events.at(i);
+        const QDomNamedNodeMap attributes = event.attributes();
+
+        EventKey destKey;
+        destKey.type = attributes.namedItem("eventtype").nodeValue().toInt();
+        destKey.id = attributes.namedItem("enumb").nodeValue().toInt();
+        destKey.with = names.intern(attributes.namedItem("ename").nodeValue());
+
+        const QJsonObject eventJson = eventToJson(destKey.type, destKey.id, names.string(destKey.with));
+
+        if (gms1EventTypeToGmk(destKey.type).isEmpty())
+        {
+            QJsonObject item = divergence("unknownEventType", "object", objectName);
+            item.insert("eventType", destKey.type);
+            result.append(item);
+            continue;
+        }
+
+        QStringList destCodes;
+        const QDomNodeList actionNodes = event.childNodes();
+        for (int j = 0; j < actionNodes.count(); ++j)
+        {
+            const QDomNode action = actionNodes.at(j);
+            if (action.nodeName() == "action" && action.namedItem("kind").firstChild().nodeValue() == "7")
+            {
+                destCodes.append(action.namedItem("arguments").namedItem("argument").namedItem("string").firstChild().nodeValue());
+            }
+        }
+
+        const auto sourceEventIt = sourceEventsIndex.constFind(destKey);
+        if (sourceEventIt == sourceEventsIndex.constEnd())
+        {
+            QJsonObject item = divergence("eventMissingInGmk", "object", objectName);
+            item.insert("event", eventJson);
+            result.append(item);
+            continue;
+        }
+
+        matched[sourceEventIt.value()] = true;
+
+        const QVector<int>& sourceCodes = sourceEvents.at(sourceEventIt.value()).codes;
+
+        if (sourceCodes.count() != destCodes.count())
+        {
+            QJsonObject item = divergence("codeCountMismatch", "object", objectName);
+            item.insert("event", eventJson);
+            item.insert("gmkCount", sourceCodes.count());
+            item.insert("gms1Count", destCodes.count());
+            result.append(item);
+        }
+
+        for (int j = 0; j < std::min(sourceCodes.count(), destCodes.count()); ++j)
+        {
+            QString sourceHash;
+            QString destHash;
+            if (!isSameCode(codes, sourceCodes.at(j), destCodes.at(j), sourceHash, destHash))
+            {
+                QJsonObject item = divergence("codeDiffers", "object", objectName);
+                item.insert("event", eventJson);
+                item.insert("index", j);
+                item.insert("gmkHash", sourceHash);
+                item.insert("gms1Hash", destHash);
+                result.append(item);
+            }
+        }
+    }
+
+    for (int i = 0; i < sourceEvents.count(); ++i)
+    {
+        if (!matched.at(i))
+        {
+            const EventKey& key = sourceEvents.at(i).key;
+
+            QJsonObject item = divergence("eventMissingInGms1", "object", objectName);
+            item.insert("event", eventToJson(key.type, key.id, names.string(key.with)));
+            item.insert("gmkCount", sourceEvents.at(i).codes.count());
+            result.append(item);
+        }
+    }
+
+    return result;
+}
+
+QJsonArray GMS1Corrector::auditRoom(const QString &sourceFileName, const QString &gms1folder, CodeStats &codeStats)
+{
+    QJsonArray result;
+
+    const QFileInfo sourceRoomFileInfo(sourceFileName);
+    const QString roomName = sourceRoomFileInfo.fileName().left(sourceRoomFileInfo.fileName().length() - 4);
+
+    StringPool names;
+    CodePool codes;
+    const CodeStats::Scope codeStatsScope(codeStats, codes);
+    QString code;
+    QVector<Instance> instances;
+
+    if (!readSourceRoom(sourceFileName, names, codes, code, instances))
+    {
+        result.append(divergence("unreadable", "room", roomName));
+        return result;
+    }
+
+    const QString destFileName = gms1folder + "/rooms/" + roomName + ".room.gmx";
+    if (!QFile::exists(destFileName))
+    {
+        result.append(divergence("missingInGms1", "room", roomName));
+        return result;
+    }
+
+    QByteArray destData;
+    QDomDocument destDom;
+    if (!readFile(destFileName, destData) || !destDom.setContent(destData))
+    {
+        result.append(divergence("unreadable", "room", roomName));
+        return result;
+    }
+
+    const QDomNode roomNode = destDom.namedItem("room");
+
+    const QString sourceCodeHash = codeHash(code);
+    const QString destCodeHash = codeHash(roomNode.namedItem("code").firstChild().nodeValue());
+    if (sourceCodeHash != destCodeHash)
+    {
+        QJsonObject item = divergence("roomCodeDiffers", "room", roomName);
+        item.insert("gmkHash", sourceCodeHash);
+        item.insert("gms1Hash", destCodeHash);
+        result.append(item);
+    }
+
+    const QDomNodeList destInstancesNodes = roomNode.namedItem("instances").childNodes();
+
+    if (instances.count() != destInstancesNodes.count())
+    {
+        QJsonObject item = divergence("instanceCountMismatch", "room", roomName);
+        item.insert("gmkCount", instances.count());
+        item.insert("gms1Count", destInstancesNodes.count());
+        result.append(item);
+    }
+
+    for (int i = 0; i < std::min(destInstancesNodes.count(), instances.count()); ++i)
+    {
+        const QDomNamedNodeMap attributes = destInstancesNodes.at(i).attributes();
+
+        Instance destInstance;
+        destInstance.objectName = names.intern(attributes.namedItem("objName").nodeValue());
+        destInstance.x = attributes.namedItem("x").nodeValue().toLongLong();
+        destInstance.y = attributes.namedItem("y").nodeValue().toLongLong();
+
+        const Instance& sourceInstance = instances.at(i);
+
+        if (!destInstance.isSameInstance(sourceInstance))
+        {
+            QJsonObject item = divergence("instanceOrderDrift", "room", roomName);
+            item.insert("index", i);
+            item.insert("gmk", instanceToJson(names.string(sourceInstance.objectName), sourceInstance.x, sourceInstance.y));
+            item.insert("gms1", instanceToJson(names.string(destInstance.objectName), destInstance.x, destInstance.y));
+            result.append(item);
+            continue;
+        }
+
+        QString sourceHash;
+        QString destHash;
+        if (!isSameCode(codes, sourceInstance.creationCode, attributes.namedItem("code").nodeValue(), sourceHash, destHash))
+        {
+            QJsonObject item = divergence("instanceCodeDiffers", "room", roomName);
+            item.insert("index", i);
+            item.insert("instance", instanceToJson(names.string(destInstance.objectName), destInstance.x, destInstance.y));
+            item.insert("gmkHash", sourceHash);
+            item.insert("gms1Hash", destHash);
+            result.append(item);
+        }
+    }
+
+    return result;
 }
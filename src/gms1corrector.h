@@ -1,39 +1,76 @@
 #pragma once
 
+#include "stringpool.h"
+#include "codepool.h"
 #include <QStringList>
 #include <QDomDocument>
-#include <functional>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QHash>
+#include <QVector>
 
 class GMS1Corrector
 {
 public:
-    static void setLogCallback(std::function<void(const QString&)> callback);
     static void convertAnsiToUtf8(const QString& gmkFileName, const QString& gms1folder);
 
+    // Stages of convertAnsiToUtf8, usable on their own for batch processing
+    static bool checkInput(const QString& gmkFileName, const QString& gms1folder);
+    static bool checkGmkInput(const QString& gmkFileName);
+    static bool splitGmk(const QString& gmkFileName, const QString& gmkSplitOutput);
+    // Returns the folder with gmksplit output, taken from GmkSplitCache when possible.
+    // fallbackOutput is used when the cache is disabled. Empty string on failure
+    static QString splitGmkCached(const QString& gmkFileName, const QString& fallbackOutput);
+    static QStringList findScripts(const QString& gmkSplitOutput);
+    static QStringList findObjects(const QString& gmkSplitOutput);
+    static QStringList findRooms(const QString& gmkSplitOutput);
+    static bool copyScript(const QString& sourceFileName, const QString& gms1folder);
+    // The code blocks of a resource are released with it, only their stats are added to codeStats
+    static bool correctObject(const QString& objectDirName, const QString& gms1folder, CodeStats& codeStats);
+    static bool correctRoom(const QString& sourceFileName, const QString& gms1folder, CodeStats& codeStats);
+
+    // Rooms whose DOM would need more memory than the cap are corrected by streaming, the memory
+    // used then stays below the cap however large the room is. 0 - always DOM. 256 MB by default
+    static void setRoomMemoryCap(qint64 bytes);
+    static qint64 roomMemoryCap();
+
+    static void logCodeStats(const CodePool::Stats& stats);
+
+    // Read-only comparison of the GMK and the GMS1 project, returns a report of every divergence
+    static QJsonObject audit(const QString& gmkFileName, const QString& gms1folder, CodeStats& codeStats);
+    static QJsonArray auditScript(const QString& sourceFileName, const QString& gms1folder);
+    static QJsonArray auditObject(const QString& objectDirName, const QString& gms1folder, CodeStats& codeStats);
+    static QJsonArray auditRoom(const QString& sourceFileName, const QString& gms1folder, CodeStats& codeStats);
+
 private:
-    struct SourceEvent
+    // GMS2Corrector reads the split GMK with the same parsers
+    friend class GMS2Corrector;
+
+    struct EventKey
     {
-        SourceEvent(const QString& type_, const QString& id_, const QString& with_)
-            : type(type_), id(id_), with(with_) {}
+        int type = -1;
+        int id = -1;
+        int with = -1; // id in the object names pool
 
-        QString type;
-        QString id;
-        QString with;
+        bool operator==(const EventKey& other) const
+        {
+            return type == other.type && id == other.id && with == other.with;
+        }
+    };
+    friend uint qHash(const EventKey& key, uint seed);
 
-        QStringList codes;
+    struct SourceEvent
+    {
+        EventKey key;
+        QVector<int> codes; // ids in the code pool of the object
     };
 
     struct Instance
     {
-        QString objectName;
+        int objectName = -1; // id in the object names pool
         int64_t x = 0;
         int64_t y = 0;
-        QString creationCode;
-
-        QString getInfoString() const
-        {
-            return QString("\"%1\" at (%2, %3)").arg(objectName).arg(x).arg(y);
-        }
+        int creationCode = -1; // id in the code pool of the room, of the chunk when streaming
 
         bool isSameInstance(const Instance& other) const
         {
@@ -42,10 +79,22 @@ private:
     };
     friend bool operator<(const Instance& a, const Instance& b);
 
+    static QString gmkSplitFileName();
+
     static void copyScripts(const QString& gmkSplitOutput, const QString& gms1folder);
 
-    static void correctObjectsCodes(const QString& gmkSplitOutput, const QString& gms1folder);
-    static void correctObjectCodes(const QString& objectName, const QString& gms1folder, const QList<SourceEvent>& sourceEvents);
+    static void correctObjectsCodes(const QString& gmkSplitOutput, const QString& gms1folder, CodeStats& codeStats);
+    static QString objectNameFromDir(const QString& objectDirName);
+    static QString gmkEventTypeName(int type);
+    static QVector<SourceEvent> readSourceEvents(const QString& objectDirName, StringPool& names, CodePool& codes);
+    static bool readSourceRoom(const QString& sourceFileName, StringPool& names, CodePool& codes, QString& code, QVector<Instance>& instances);
+
+    static bool correctObjectCodes(const QString& objectName, const QString& gms1folder, const QVector<SourceEvent>& sourceEvents, StringPool& names, CodePool& codes);
+
+    static void correctRoomsCreationCode(const QString& gmkSplitOutput, const QString& gms1folder, CodeStats& codeStats);
+    static bool correctRoomDom(const QString& sourceFileName, const QString& destFileName, const QString& roomName, CodePool& codes);
+    static bool correctRoomStreaming(const QString& sourceFileName, const QString& destFileName, const QString& roomName);
+    static bool readSourceRoomCode(const QString& sourceFileName, QString& code);
 
-    static void correctRoomsCreationCode(const QString& gmkSplitOutput, const QString& gms1folder);
+    class SourceInstanceReader;
 };
@@ -1,18 +1,70 @@
 #include "gms2corrector.h"
-#include <QDirIterator>
+#include "gms1corrector.h"
+#include "gmksplitcache.h"
+#include "workspace.h"
+#include "yyjson.h"
+#include "iothrottle.h"
+#include "batchio.h"
+#include "dirwalker.h"
+#include "fileutils.h"
+#include "logger.h"
 #include <QFile>
+#include <QFileInfo>
 #include <QDir>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QRegularExpression>
+#include <QtConcurrent>
+#include <algorithm>
 
 namespace
 {
 
-static std::function<void(const QString&)> logCallback = nullptr;
+using Severity = Logger::Severity;
+using Event = Logger::Event;
 
+// Indexed by the GMS1 event type, GMS2 names event files after them
+static const QStringList EventTypeNames =
+{
+    "Create",
+    "Destroy",
+    "Alarm",
+    "Step",
+    "Collision",
+    "Keyboard",
+    "Mouse",
+    "Other",
+    "Draw",
+    "KeyPress",
+    "KeyRelease",
+};
+
+static const int CollisionEventType = 4;
+
+static const int ReadWindow = 1024;
+
+static const QString DescriptionPrefix = "/// @description";
+
+// Instances of all instance layers, layers can be nested
+void collectInstances(const QJsonArray& layers, QHash<QString, QJsonObject>& instances, QStringList& order)
+{
+    for (const QJsonValue& layerValue : layers)
+    {
+        const QJsonObject layer = layerValue.toObject();
+
+        for (const QJsonValue& instanceValue : layer.value("instances").toArray())
+        {
+            const QJsonObject instance = instanceValue.toObject();
+            const QString name = instance.value("name").toString();
+
+            instances.insert(name, instance);
+            order.append(name);
+        }
+
+        collectInstances(layer.value("layers").toArray(), instances, order);
+    }
 }
 
-void GMS2Corrector::setLogCallback(std::function<void (const QString &)> callback)
-{
-    logCallback = callback;
 }
 
 void GMS2Corrector::breakToExit(const QString& gms2folder)
@@ -22,73 +74,123 @@ void GMS2Corrector::breakToExit(const QString& gms2folder)
         return;
     }
 
-    QDirIterator it(gms2folder, QStringList() << "*.gml", QDir::Files, QDirIterator::Subdirectories);
-    while (it.hasNext())
+    forEachFile(findCodeFiles(gms2folder), [](const QString& fileName, const QByteArray& data)
     {
-        const QString fileName = it.next();
+        breakToExitText(fileName, data);
+    });
 
-        QByteArray data = readFile(fileName);
+    Logger::log(Severity::Info, Event::Done);
+}
 
-        if (!isContainsWord(data, "break"))
-        {
-            continue;
-        }
+void GMS2Corrector::replace(const QString& gms2folder, const QString &from, const QString &to)
+{
+    if (!checkInput(gms2folder))
+    {
+        return;
+    }
 
-        if (isContainsWord(data, "for") || isContainsWord(data, "while") || isContainsWord(data, "repeat")  || isContainsWord(data, "do") || isContainsWord(data, "switch") || isContainsWord(data, "with"))
-        {
-            log(QString("Ignore file \"%1\", contains stop-word").arg(fileName));
-            continue;
-        }
+    forEachFile(findCodeFiles(gms2folder), [&from, &to](const QString& fileName, const QByteArray& data)
+    {
+        replaceInText(fileName, data, from, to);
+    });
+}
+
+QStringList GMS2Corrector::findCodeFiles(const QString &gms2folder)
+{
+    // Resource folders that never contain code
+    static const QStringList PrunedDirs = { "sprites", "sounds", "fonts", "tilesets", "paths", "sequences", "animcurves", "datafiles", "options" };
+
+    return DirWalker::findFiles(gms2folder, { ".gml" }, PrunedDirs);
+}
+
+void GMS2Corrector::forEachFile(const QStringList &fileNames, const std::function<void(const QString&, const QByteArray&)> &function)
+{
+    // Files are read in batches, a window bounds the memory taken by one batch
+    for (int begin = 0; begin < fileNames.count(); begin += ReadWindow)
+    {
+        const QStringList window = fileNames.mid(begin, ReadWindow);
+        const QVector<BatchIo::ReadResult> files = BatchIo::readFiles(window, true);
 
-        QFile file(fileName);
-        if (!file.open(QFile::WriteOnly | QFile::Text | QFile::Truncate))
+        for (int i = 0; i < window.count(); ++i)
         {
-            log(QString("Failed to open file \"%1\"").arg(fileName));
-            continue;
-        }
+            if (!files.at(i).ok)
+            {
+                Logger::log(Severity::Error, Event::FileReadFailed, window.at(i));
+                continue;
+            }
 
-        data = data.replace("break", "exit");
-        file.write(data);
+            function(window.at(i), files.at(i).data);
+        }
+    }
+}
 
-        log(QString("Replaced 'break' to 'exit' in file \"%1\"").arg(fileName));
+bool GMS2Corrector::breakToExitFile(const QString &fileName)
+{
+    QByteArray data;
+    if (!readFile(fileName, data))
+    {
+        return false;
     }
 
-    log("Done!");
+    return breakToExitText(fileName, data);
 }
 
-void GMS2Corrector::replace(const QString& gms2folder, const QString &from, const QString &to)
+bool GMS2Corrector::breakToExitText(const QString &fileName, QByteArray data)
 {
-    if (!checkInput(gms2folder))
+    if (!isContainsWord(data, "break"))
     {
-        return;
+        return true;
     }
 
-    QDirIterator it(gms2folder, QStringList() << "*.gml", QDir::Files, QDirIterator::Subdirectories);
-    while (it.hasNext())
+    if (isContainsWord(data, "for") || isContainsWord(data, "while") || isContainsWord(data, "repeat")  || isContainsWord(data, "do") || isContainsWord(data, "switch") || isContainsWord(data, "with"))
     {
-        const QString fileName = it.next();
+        Logger::log(Severity::Info, Event::StopWordIgnored, fileName);
+        return true;
+    }
 
-        const QByteArray prevData = readFile(fileName);
+    data = data.replace("break", "exit");
 
-        QByteArray resultData = prevData;
-        resultData = resultData.replace(from.toUtf8(), to.toUtf8());
+    if (FileUtils::writeIfChanged(fileName, data) == FileUtils::Result::Failed)
+    {
+        Logger::log(Severity::Error, Event::FileWriteFailed, fileName);
+        return false;
+    }
 
-        if (resultData == prevData)
-        {
-            continue;
-        }
+    Logger::log(Severity::Info, Event::BreakReplaced, fileName);
 
-        QFile file(fileName);
-        if (!file.open(QFile::WriteOnly | QFile::Text | QFile::Truncate))
-        {
-            log(QString("Failed to open file \"%1\" for write").arg(fileName));
-            continue;
-        }
+    return true;
+}
 
-        file.write(resultData);
+bool GMS2Corrector::replaceInFile(const QString &fileName, const QString &from, const QString &to)
+{
+    QByteArray data;
+    if (!readFile(fileName, data))
+    {
+        return false;
+    }
 
-        log(QString("Replaced \"%1\" to \"%2\" in file \"%3\"").arg(from, to, fileName));
+    return replaceInText(fileName, data, from, to);
+}
+
+bool GMS2Corrector::replaceInText(const QString &fileName, const QByteArray &prevData, const QString &from, const QString &to)
+{
+    QByteArray resultData = prevData;
+    resultData = resultData.replace(from.toUtf8(), to.toUtf8());
+
+    if (resultData == prevData)
+    {
+        return true;
+    }
+
+    if (FileUtils::writeIfChanged(fileName, resultData) == FileUtils::Result::Failed)
+    {
+        Logger::log(Severity::Error, Event::FileWriteFailed, fileName);
+        return false;
     }
+
+    Logger::log(Severity::Info, Event::TextReplaced, from, to, fileName);
+
+    return true;
 }
 
 bool GMS2Corrector::checkInput(const QString &gms2folder)
@@ -100,7 +202,7 @@ bool GMS2Corrector::checkInput(const QString &gms2folder)
     QDir root(gms2folder);
     if (!root.exists())
     {
-        log(QString("Folder \"%1\" not exists!").arg(gms2folder));
+        Logger::log(Severity::Error, Event::FolderNotFound, gms2folder);
         return false;
     }
 
@@ -116,7 +218,7 @@ bool GMS2Corrector::checkInput(const QString &gms2folder)
 
     if (!foundProjectFile)
     {
-        log(QString("GMS2 Folder project does not contain a project file %1").arg(FileProjectSuffix));
+        Logger::log(Severity::Error, Event::ProjectFileNotFound, "GMS2", FileProjectSuffix);
         return false;
     }
 
@@ -150,24 +252,378 @@ bool GMS2Corrector::isContainsWord(const QByteArray &text, const QByteArray &wor
     return false;
 }
 
-void GMS2Corrector::log(const QString &text)
+bool GMS2Corrector::readFile(const QString &fileName, QByteArray &data)
 {
-    qDebug(text.toUtf8());
+    IoThrottle::Guard guard;
 
-    if (logCallback)
+    QFile file(fileName);
+    if (!file.open(QFile::ReadOnly | QFile::Text))
     {
-        logCallback(text);
+        Logger::log(Severity::Error, Event::FileReadFailed, file.fileName());
+        return false;
     }
+
+    data = file.readAll();
+
+    return true;
 }
 
-QByteArray GMS2Corrector::readFile(const QString &fileName)
+void GMS2Corrector::convertAnsiToUtf8(const QString &gmkFileName, const QString &gms2folder)
 {
-    QFile file(fileName);
-    if (!file.open(QFile::ReadOnly | QFile::Text))
+    if (!checkInput(gmkFileName, gms2folder))
+    {
+        return;
+    }
+
+    const Workspace workspace;
+    if (!workspace.isValid())
+    {
+        Logger::log(Severity::Error, Event::TempFolderNotFound);
+        return;
+    }
+
+    const GmkSplitCache::Usage cacheUsage;
+
+    const QString gmkSplitOutput = GMS1Corrector::splitGmkCached(gmkFileName, workspace.filePath("gmksplit_output"));
+    if (gmkSplitOutput.isEmpty())
+    {
+        return;
+    }
+
+    QStringList scripts = GMS1Corrector::findScripts(gmkSplitOutput);
+    QStringList objects = GMS1Corrector::findObjects(gmkSplitOutput);
+    QStringList rooms = GMS1Corrector::findRooms(gmkSplitOutput);
+
+    CodeStats codeStats;
+
+    QtConcurrent::blockingMap(scripts, [&gms2folder](const QString& fileName) { copyScript(fileName, gms2folder); });
+    QtConcurrent::blockingMap(objects, [&gms2folder, &codeStats](const QString& dirName) { correctObject(dirName, gms2folder, codeStats); });
+    QtConcurrent::blockingMap(rooms, [&gms2folder, &codeStats](const QString& fileName) { correctRoom(fileName, gms2folder, codeStats); });
+
+    GMS1Corrector::logCodeStats(codeStats.stats());
+
+    Logger::log(Severity::Info, Event::Done);
+}
+
+bool GMS2Corrector::checkInput(const QString &gmkFileName, const QString &gms2folder)
+{
+    return GMS1Corrector::checkGmkInput(gmkFileName) && checkInput(gms2folder);
+}
+
+bool GMS2Corrector::copyScript(const QString &sourceFileName, const QString &gms2folder)
+{
+    const QString scriptName = QFileInfo(sourceFileName).completeBaseName();
+    const QString destFileName = gms2folder + "/scripts/" + scriptName + "/" + scriptName + ".gml";
+    if (!QFile::exists(destFileName))
+    {
+        Logger::log(Severity::Warning, Event::FileNotFound, destFileName);
+        return false;
+    }
+
+    QByteArray sourceData;
+    QByteArray destData;
+    if (!readFile(sourceFileName, sourceData) || !readFile(destFileName, destData))
+    {
+        return false;
+    }
+
+    QString code = QString::fromUtf8(sourceData);
+    const QString prevCode = QString::fromUtf8(destData);
+
+    // GMS 2.3 wraps imported scripts into a function, the wrapper stays and only its body is replaced
+    const QRegularExpression functionHeader(QString("^\\s*function\\s+%1\\s*\\(").arg(QRegularExpression::escape(scriptName)),
+                                            QRegularExpression::MultilineOption);
+    const QRegularExpressionMatch match = functionHeader.match(prevCode);
+    if (match.hasMatch())
+    {
+        const int bodyBegin = prevCode.indexOf('{', match.capturedEnd());
+        const int bodyEnd = prevCode.lastIndexOf('}');
+        if (bodyBegin != -1 && bodyEnd > bodyBegin)
+        {
+            code = prevCode.left(bodyBegin + 1) + "\n" + code + "\n" + prevCode.mid(bodyEnd);
+        }
+    }
+
+    switch (FileUtils::writeIfChanged(destFileName, code.toUtf8()))
+    {
+    case FileUtils::Result::Failed:
+        Logger::log(Severity::Error, Event::FileWriteFailed, destFileName);
+        return false;
+
+    case FileUtils::Result::Unchanged:
+        return true;
+
+    case FileUtils::Result::Changed:
+        Logger::log(Severity::Info, Event::ScriptCorrected, scriptName);
+        return true;
+    }
+
+    return true;
+}
+
+bool GMS2Corrector::correctObject(const QString &objectDirName, const QString &gms2folder, CodeStats &codeStats)
+{
+    StringPool names;
+    CodePool codes;
+    const CodeStats::Scope codeStatsScope(codeStats, codes);
+
+    const QString objectName = GMS1Corrector::objectNameFromDir(objectDirName);
+    const QVector<GMS1Corrector::SourceEvent> sourceEvents = GMS1Corrector::readSourceEvents(objectDirName, names, codes);
+
+    const QString objectFolder = gms2folder + "/objects/" + objectName;
+    if (!QDir(objectFolder).exists())
+    {
+        Logger::log(Severity::Warning, Event::FolderNotFound, objectFolder);
+        return false;
+    }
+
+    bool result = true;
+    bool changed = false;
+
+    for (const GMS1Corrector::SourceEvent& sourceEvent : sourceEvents)
+    {
+        if (sourceEvent.codes.isEmpty())
+        {
+            continue;
+        }
+
+        const QString with = names.string(sourceEvent.key.with);
+
+        const QString fileName = eventFileName(sourceEvent.key.type, sourceEvent.key.id, with);
+        if (fileName.isEmpty())
+        {
+            // GMS2 has no file for the event, trigger events for example
+            Logger::log(Severity::Warning, Event::UnknownEventType, GMS1Corrector::gmkEventTypeName(sourceEvent.key.type), objectName);
+            continue;
+        }
+
+        const QString destFileName = objectFolder + "/" + fileName;
+        if (!QFile::exists(destFileName))
+        {
+            Logger::log(Severity::Warning, Event::Gms2EventNotFound, fileName, objectName);
+            continue;
+        }
+
+        // GMS2 has one code file per event, there is no way to tell which part of it came from which code action
+        if (sourceEvent.codes.count() > 1)
+        {
+            Logger::log(Severity::Warning, Event::MultipleCodesSkipped, fileName, objectName, sourceEvent.codes.count());
+            continue;
+        }
+
+        switch (writeCode(destFileName, codes.code(sourceEvent.codes.first())))
+        {
+        case FileUtils::Result::Failed:
+            result = false;
+            break;
+
+        case FileUtils::Result::Unchanged:
+            break;
+
+        case FileUtils::Result::Changed:
+            changed = true;
+            break;
+        }
+    }
+
+    if (changed)
+    {
+        Logger::log(Severity::Info, Event::ObjectCorrected, objectName);
+    }
+
+    return result;
+}
+
+bool GMS2Corrector::correctRoom(const QString &sourceFileName, const QString &gms2folder, CodeStats &codeStats)
+{
+    const QFileInfo sourceRoomFileInfo(sourceFileName);
+    const QString roomName = sourceRoomFileInfo.fileName().left(sourceRoomFileInfo.fileName().length() - 4);
+
+    StringPool names;
+    CodePool codes;
+    const CodeStats::Scope codeStatsScope(codeStats, codes);
+    QString code;
+    QVector<GMS1Corrector::Instance> instances;
+
+    if (!GMS1Corrector::readSourceRoom(sourceFileName, names, codes, code, instances))
+    {
+        return false;
+    }
+
+    const QString roomFolder = gms2folder + "/rooms/" + roomName;
+    const QString yyFileName = roomFolder + "/" + roomName + ".yy";
+    if (!QFile::exists(yyFileName))
+    {
+        Logger::log(Severity::Warning, Event::FileNotFound, yyFileName);
+        return false;
+    }
+
+    QByteArray yyData;
+    if (!readFile(yyFileName, yyData))
+    {
+        return false;
+    }
+
+    QJsonParseError parseError;
+    const QJsonObject room = YyJson::parse(yyData, &parseError).object();
+    if (parseError.error != QJsonParseError::NoError)
+    {
+        Logger::log(Severity::Error, Event::JsonLoadFailed, yyFileName, parseError.errorString());
+        return false;
+    }
+
+    QVector<Logger::Record> msgs;
+
+    bool result = true;
+    bool roomChanged = false;
+
+    const QString roomCodeFileName = roomFolder + "/RoomCreationCode.gml";
+    if (!code.isEmpty() || QFile::exists(roomCodeFileName))
+    {
+        const FileUtils::Result codeResult = writeCode(roomCodeFileName, code);
+        result = codeResult != FileUtils::Result::Failed && result;
+        roomChanged = codeResult == FileUtils::Result::Changed;
+
+        // A room without code in GMS2 does not reference the code file yet
+        if (!code.isEmpty() && room.value("creationCodeFile").toString().isEmpty())
+        {
+            const QByteArray path = "\"${project_dir}/rooms/" + roomName.toUtf8() + "/RoomCreationCode.gml\"";
+
+            if (YyJson::setValue(yyData, roomName.toUtf8(), "creationCodeFile", path))
+            {
+                if (FileUtils::writeIfChanged(yyFileName, yyData) == FileUtils::Result::Failed)
+                {
+                    Logger::log(Severity::Error, Event::FileWriteFailed, yyFileName);
+                    result = false;
+                }
+                else
+                {
+                    roomChanged = true;
+                }
+            }
+        }
+    }
+
+    QHash<QString, QJsonObject> destInstances;
+    QStringList layersOrder;
+    collectInstances(room.value("layers").toArray(), destInstances, layersOrder);
+
+    QStringList order;
+    for (const QJsonValue& value : room.value("instanceCreationOrder").toArray())
+    {
+        const QString name = value.isObject() ? value.toObject().value("name").toString() : value.toString();
+        if (destInstances.contains(name))
+        {
+            order.append(name);
+        }
+    }
+
+    if (order.count() != destInstances.count())
+    {
+        order = layersOrder;
+    }
+
+    if (instances.count() != order.count())
+    {
+        Logger::log(Severity::Warning, Event::InstanceCountMismatch, instances.count(), order.count(), roomName);
+    }
+
+    for (int i = 0; i < std::min(order.count(), instances.count()); ++i)
+    {
+        const QJsonObject destInstanceObject = destInstances.value(order.at(i));
+
+        if (!destInstanceObject.value("hasCreationCode").toBool())
+        {
+            continue;
+        }
+
+        GMS1Corrector::Instance destInstance;
+        destInstance.objectName = names.intern(destInstanceObject.value("objectId").toObject().value("name").toString());
+        destInstance.x = qRound64(destInstanceObject.value("x").toDouble());
+        destInstance.y = qRound64(destInstanceObject.value("y").toDouble());
+
+        const GMS1Corrector::Instance& sourceInstance = instances.at(i);
+
+        if (destInstance.isSameInstance(sourceInstance))
+        {
+            const QString instanceCodeFileName = roomFolder + "/InstanceCreationCode_" + order.at(i) + ".gml";
+
+            switch (writeCode(instanceCodeFileName, codes.code(sourceInstance.creationCode)))
+            {
+            case FileUtils::Result::Failed:
+                result = false;
+                break;
+
+            case FileUtils::Result::Unchanged:
+                break;
+
+            case FileUtils::Result::Changed:
+                Logger::append(msgs, Severity::Info, Event::InstanceCorrected,
+                               names.string(destInstance.objectName), qint64(destInstance.x), qint64(destInstance.y), roomName);
+                break;
+            }
+        }
+        else
+        {
+            Logger::append(msgs, Severity::Warning, Event::InstanceMismatch,
+                           i, names.string(sourceInstance.objectName), qint64(sourceInstance.x), qint64(sourceInstance.y),
+                           names.string(destInstance.objectName), qint64(destInstance.x), qint64(destInstance.y), roomName);
+        }
+    }
+
+    if (roomChanged)
+    {
+        Logger::append(msgs, Severity::Info, Event::RoomCorrected, roomName);
+    }
+
+    for (const Logger::Record& msg : msgs)
+    {
+        Logger::write(msg);
+    }
+
+    return result;
+}
+
+QString GMS2Corrector::eventFileName(int type, int id, const QString &with)
+{
+    if (type < 0 || type >= EventTypeNames.count())
+    {
+        return QString();
+    }
+
+    if (type == CollisionEventType)
+    {
+        return EventTypeNames.at(type) + "_" + with + ".gml";
+    }
+
+    return EventTypeNames.at(type) + "_" + QString::number(id) + ".gml";
+}
+
+FileUtils::Result GMS2Corrector::writeCode(const QString &fileName, const QString &code)
+{
+    QString text = code;
+
+    QByteArray prevData;
+    if (QFile::exists(fileName))
+    {
+        if (!readFile(fileName, prevData))
+        {
+            return FileUtils::Result::Failed;
+        }
+    }
+
+    const QString prevText = QString::fromUtf8(prevData);
+    if (prevText.startsWith(DescriptionPrefix) && !code.startsWith(DescriptionPrefix))
+    {
+        const int lineEnd = prevText.indexOf('\n');
+        text = (lineEnd == -1 ? prevText : prevText.left(lineEnd)) + "\n" + code;
+    }
+
+    const FileUtils::Result result = FileUtils::writeIfChanged(fileName, text.toUtf8());
+    if (result == FileUtils::Result::Failed)
     {
-        log(QString("Failed to open file \"%1\"").arg(file.fileName()));
-        return QByteArray();
+        Logger::log(Severity::Error, Event::FileWriteFailed, fileName);
     }
 
-    return file.readAll();
+    return result;
 }
@@ -1,19 +1,39 @@
 #pragma once
 
+#include "codepool.h"
+#include "fileutils.h"
 #include <QString>
+#include <QStringList>
 #include <functional>
 
 class GMS2Corrector
 {
 public:
-    static void setLogCallback(std::function<void(const QString&)> callback);
     static void breakToExit(const QString& gms2folder);
     static void replace(const QString& gms2folder, const QString& from, const QString& to);
 
-private:
+    // Stages of breakToExit and replace, usable on their own for batch processing
     static bool checkInput(const QString& gms2folder);
+    static QStringList findCodeFiles(const QString& gms2folder);
+    static bool breakToExitFile(const QString& fileName);
+    static bool replaceInFile(const QString& fileName, const QString& from, const QString& to);
+
+    // Encoding correction of the GMS2 project straight from the GMK, without going through GMS1
+    static void convertAnsiToUtf8(const QString& gmkFileName, const QString& gms2folder);
 
+    // Stages of convertAnsiToUtf8. Every resource has its own files, so they can run in parallel
+    static bool checkInput(const QString& gmkFileName, const QString& gms2folder);
+    static bool copyScript(const QString& sourceFileName, const QString& gms2folder);
+    static bool correctObject(const QString& objectDirName, const QString& gms2folder, CodeStats& codeStats);
+    static bool correctRoom(const QString& sourceFileName, const QString& gms2folder, CodeStats& codeStats);
+
+private:
+    static QString eventFileName(int type, int id, const QString& with);
+    // Replaces the code in the file, the "/// @description" line added by GMS2 stays
+    static FileUtils::Result writeCode(const QString& fileName, const QString& code);
+    static bool breakToExitText(const QString& fileName, QByteArray data);
+    static bool replaceInText(const QString& fileName, const QByteArray& prevData, const QString& from, const QString& to);
+    static void forEachFile(const QStringList& fileNames, const std::function<void(const QString&, const QByteArray&)>& function);
+    static bool readFile(const QString& fileName, QByteArray& data);
     static bool isContainsWord(const QByteArray& text, const QByteArray& word);
-    static void log(const QString& text);
-    static QByteArray readFile(const QString& fileName);
 };
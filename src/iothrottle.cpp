@@ -0,0 +1,41 @@
+#include "iothrottle.h"
+#include <QSemaphore>
+#include <memory>
+#include <algorithm>
+
+namespace
+{
+
+static int maxCount = 0;
+static std::unique_ptr<QSemaphore> sharedSemaphore;
+
+}
+
+void IoThrottle::setMaxConcurrentIo(int count)
+{
+    maxCount = std::max(0, count);
+    sharedSemaphore.reset(maxCount > 0 ? new QSemaphore(maxCount) : nullptr);
+}
+
+int IoThrottle::maxConcurrentIo()
+{
+    return maxCount;
+}
+
+IoThrottle::Guard::Guard(int count)
+    : semaphore(sharedSemaphore.get())
+    , count(count)
+{
+    if (semaphore)
+    {
+        semaphore->acquire(count);
+    }
+}
+
+IoThrottle::Guard::~Guard()
+{
+    if (semaphore)
+    {
+        semaphore->release(count);
+    }
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <QtGlobal>
+
+class QSemaphore;
+
+// Limits the number of file operations running at the same time.
+// Unlimited by default, the limit is only useful when many threads hit the same disk.
+class IoThrottle
+{
+public:
+    // 0 - unlimited. Must not be changed while file operations are in progress
+    static void setMaxConcurrentIo(int count);
+    static int maxConcurrentIo();
+
+    class Guard
+    {
+    public:
+        // One permit per file operation, count must not exceed a set limit
+        explicit Guard(int count = 1);
+        ~Guard();
+
+    private:
+        Q_DISABLE_COPY(Guard)
+        QSemaphore* semaphore = nullptr;
+        int count = 0;
+    };
+};
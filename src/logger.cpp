@@ -0,0 +1,270 @@
+#include "logger.h"
+#include <QAtomicInt>
+#include <QMutex>
+#include <QReadWriteLock>
+#include <QMap>
+#include <QQueue>
+#include <algorithm>
+#include <iterator>
+
+namespace
+{
+
+struct EventInfo
+{
+    const char* name;
+    const char* format;
+};
+
+// In the order of Logger::Event
+static const EventInfo EventInfos[] =
+{
+    { "Message", "%1" },
+    { "Done", "Done!" },
+
+    { "FileNotFound", "File \"%1\" not found" },
+    { "FolderNotFound", "Folder \"%1\" not exists!" },
+    { "ProjectFileNotFound", "%1 Folder project does not contain a project file %2" },
+    { "TempFolderNotFound", "Writable temp directory not found" },
+    { "FolderDeleteFailed", "Problem deleting folder \"%1\"" },
+    { "FileReadFailed", "Failed to open file \"%1\" for read" },
+    { "FileWriteFailed", "Failed to write file \"%1\"" },
+    { "FileCopyFailed", "Failed to copy \"%1\" to \"%2\"" },
+    { "DomLoadFailed", "Failed to load DOM content from \"%1\"" },
+    { "JsonLoadFailed", "Failed to load JSON content from \"%1\": %2" },
+
+    { "GmkSplitStarted", "GmkSplit started (%1)" },
+    { "GmkSplitOutput", "GmkSplit output: \"%1\"" },
+    { "GmkSplitCached", "Using cached GmkSplit output \"%1\"" },
+    { "GmkSplitFinished", "GmkSplit finished" },
+    { "GmkSplitFailed", "Failed to execute GmkSplit, exit code: %1" },
+    { "GmkSplitNotStarted", "Failed to start GmkSplit \"%1\": %2" },
+    { "GmkSplitNoOutput", "GmkSplit did not create folder \"%1\"" },
+    { "GmkSplitWorkerStarted", "GmkSplit worker started, threads: %1" },
+    { "GmkSplitWorkerFailed", "GmkSplit worker failed: %1" },
+
+    { "ScriptCorrected", "Corrected script code \"%1\"" },
+    { "ObjectCorrected", "Corrected object code \"%1\"" },
+    { "RoomCorrected", "Corrected room creation code \"%1\"" },
+    { "InstanceCorrected", "Corrected instance creation code \"%1\" at (%2, %3) in room \"%4\"" },
+
+    { "UnknownEventType", "Unknown event type \"%1\" in object \"%2\"" },
+    { "EventNotFound", "Not found GM7/8 event for GMS1 event \"%1\" (%2) in object \"%3\"" },
+    { "FewerCodes", "Fewer GM7/8 codes than GMS1 codes in event \"%1\" (%2) in object \"%3\"" },
+    { "CodeCountMismatch", "The number of GM7/8 codes (%1) does not match the number of GMS1 codes (%2) in object \"%3\", event: %4 (%5)" },
+    { "InstanceCountMismatch", "The number of instances in projects GM7/8 (count: %1) and GMS (count: %2) does not match in room \"%3\"" },
+    { "InstanceMismatch", "At index %1 found \"%2\" at (%3, %4) but need \"%5\" at (%6, %7) in room \"%8\"" },
+    { "Gms2EventNotFound", "Not found GMS2 event file \"%1\" for GM7/8 event in object \"%2\"" },
+    { "MultipleCodesSkipped", "GM7/8 event \"%1\" in object \"%2\" has %3 codes, GMS2 event file is not changed" },
+
+    { "StopWordIgnored", "Ignore file \"%1\", contains stop-word" },
+    { "BreakReplaced", "Replaced 'break' to 'exit' in file \"%1\"" },
+    { "TextReplaced", "Replaced \"%1\" to \"%2\" in file \"%3\"" },
+
+    { "CodeStats", "Code blocks: %1, unique: %2, duplicates: %3 bytes" },
+
+    { "SnapshotSaved", "Snapshot \"%1\" saved, files: %2" },
+    { "SnapshotFailed", "Failed to keep file \"%1\" in the snapshot" },
+    { "SnapshotRestored", "Snapshot \"%1\" restored, files: %2" },
+    { "SnapshotRestoreFailed", "Failed to restore file \"%1\" from the snapshot" },
+};
+
+static_assert(sizeof(EventInfos) / sizeof(EventInfos[0]) == static_cast<int>(Logger::Event::Count), "EventInfos must match Logger::Event");
+
+struct SinkInfo
+{
+    Logger::Severity minSeverity;
+    Logger::Sink sink;
+};
+
+static QMutex mutex;
+// Read while sinks are called, so removeSink waits for the calls in progress. Recursive for sinks that log
+static QReadWriteLock sinkCallLock(QReadWriteLock::Recursive);
+static QMap<int, SinkInfo> sinks;
+static int nextSinkId = 0;
+static bool storeEnabled = false;
+static Logger::Severity storeSeverity = Logger::Severity::Warning;
+static int storeCapacity = 0;
+static QQueue<Logger::Record> storedRecords;
+static int storedCounts[static_cast<int>(Logger::Event::Count)] = {};
+
+// Lowest severity anything is interested in, checked without locking
+static QAtomicInt minSeverity = static_cast<int>(Logger::Severity::Error);
+
+}
+
+QString Logger::Record::toString() const
+{
+    const QString format = QString::fromUtf8(EventInfos[static_cast<int>(event)].format);
+
+    // One pass over the format, so "%1" inside a field value is never substituted again
+    QString text;
+    text.reserve(format.size());
+
+    for (int i = 0; i < format.size(); ++i)
+    {
+        if (format.at(i) == '%' && i + 1 < format.size() && format.at(i + 1).isDigit())
+        {
+            int number = 0;
+            int end = i + 1;
+            while (end < format.size() && format.at(end).isDigit())
+            {
+                number = number * 10 + format.at(end).digitValue();
+                end++;
+            }
+
+            if (number >= 1 && number <= fields.count())
+            {
+                text += fields.at(number - 1).toString();
+                i = end - 1;
+                continue;
+            }
+        }
+
+        text += format.at(i);
+    }
+
+    return text;
+}
+
+int Logger::addSink(Severity minSeverity, Sink sink)
+{
+    QMutexLocker locker(&mutex);
+
+    const int id = nextSinkId++;
+    sinks.insert(id, SinkInfo{ minSeverity, sink });
+
+    updateMinSeverity();
+
+    return id;
+}
+
+void Logger::removeSink(int id)
+{
+    {
+        QMutexLocker locker(&mutex);
+
+        sinks.remove(id);
+
+        updateMinSeverity();
+    }
+
+    // The sink may still be running on another thread with a copy of the list
+    QWriteLocker callLocker(&sinkCallLock);
+}
+
+void Logger::enableStore(Severity severity, int maxRecords)
+{
+    QMutexLocker locker(&mutex);
+
+    storeEnabled = maxRecords > 0;
+    storeSeverity = severity;
+    storeCapacity = maxRecords;
+
+    while (storedRecords.count() > storeCapacity)
+    {
+        storedRecords.dequeue();
+    }
+
+    updateMinSeverity();
+}
+
+QVector<Logger::Record> Logger::records(Event event)
+{
+    QMutexLocker locker(&mutex);
+
+    QVector<Record> result;
+    for (const Record& record : storedRecords)
+    {
+        if (record.event == event)
+        {
+            result.append(record);
+        }
+    }
+
+    return result;
+}
+
+int Logger::recordCount(Event event)
+{
+    QMutexLocker locker(&mutex);
+
+    return storedCounts[static_cast<int>(event)];
+}
+
+void Logger::clearRecords()
+{
+    QMutexLocker locker(&mutex);
+
+    storedRecords.clear();
+    std::fill(std::begin(storedCounts), std::end(storedCounts), 0);
+}
+
+bool Logger::isEnabled(Severity severity)
+{
+    return static_cast<int>(severity) >= minSeverity.loadRelaxed();
+}
+
+void Logger::write(const Record &record)
+{
+    QReadLocker callLocker(&sinkCallLock);
+
+    QMap<int, SinkInfo> currentSinks;
+
+    {
+        QMutexLocker locker(&mutex);
+
+        if (storeEnabled && record.severity >= storeSeverity)
+        {
+            if (storedRecords.count() >= storeCapacity)
+            {
+                storedRecords.dequeue();
+            }
+
+            storedRecords.enqueue(record);
+            storedCounts[static_cast<int>(record.event)]++;
+        }
+
+        currentSinks = sinks;
+    }
+
+    // Without the mutex, threads do not wait for each other's formatting and output
+    for (const SinkInfo& info : currentSinks)
+    {
+        if (record.severity >= info.minSeverity)
+        {
+            info.sink(record);
+        }
+    }
+}
+
+QString Logger::eventName(Event event)
+{
+    return QString::fromLatin1(EventInfos[static_cast<int>(event)].name);
+}
+
+QString Logger::severityName(Severity severity)
+{
+    switch (severity)
+    {
+    case Severity::Debug: return "Debug";
+    case Severity::Info: return "Info";
+    case Severity::Warning: return "Warning";
+    case Severity::Error: return "Error";
+    }
+
+    return QString();
+}
+
+void Logger::updateMinSeverity()
+{
+    // Nothing is built for severities no one listens to
+    Severity severity = storeEnabled ? storeSeverity : Severity::Error;
+
+    for (const SinkInfo& info : sinks)
+    {
+        severity = std::min(severity, info.minSeverity);
+    }
+
+    minSeverity.storeRelaxed(static_cast<int>(severity));
+}
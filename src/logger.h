@@ -0,0 +1,130 @@
+#pragma once
+
+#include <QString>
+#include <QVariant>
+#include <QVector>
+#include <functional>
+
+// Structured log. A record keeps its event code and typed fields, the text is only
+// formatted when a sink asks for it, and nothing is built for severities no sink wants
+class Logger
+{
+public:
+    enum class Severity
+    {
+        Debug,
+        Info,
+        Warning,
+        Error,
+    };
+
+    enum class Event
+    {
+        Message,
+        Done,
+
+        FileNotFound,
+        FolderNotFound,
+        ProjectFileNotFound,
+        TempFolderNotFound,
+        FolderDeleteFailed,
+        FileReadFailed,
+        FileWriteFailed,
+        FileCopyFailed,
+        DomLoadFailed,
+        JsonLoadFailed,
+
+        GmkSplitStarted,
+        GmkSplitOutput,
+        GmkSplitCached,
+        GmkSplitFinished,
+        GmkSplitFailed,
+        GmkSplitNotStarted,
+        GmkSplitNoOutput,
+        GmkSplitWorkerStarted,
+        GmkSplitWorkerFailed,
+
+        ScriptCorrected,
+        ObjectCorrected,
+        RoomCorrected,
+        InstanceCorrected,
+
+        UnknownEventType,
+        EventNotFound,
+        FewerCodes,
+        CodeCountMismatch,
+        InstanceCountMismatch,
+        InstanceMismatch,
+        Gms2EventNotFound,
+        MultipleCodesSkipped,
+
+        StopWordIgnored,
+        BreakReplaced,
+        TextReplaced,
+
+        CodeStats,
+
+        SnapshotSaved,
+        SnapshotFailed,
+        SnapshotRestored,
+        SnapshotRestoreFailed,
+
+        Count
+    };
+
+    struct Record
+    {
+        Severity severity;
+        Event event;
+        QVariantList fields;
+
+        QString toString() const;
+    };
+
+    using Sink = std::function<void(const Record&)>;
+
+    // Returns id for removeSink
+    static int addSink(Severity minSeverity, Sink sink);
+    static void removeSink(int id);
+
+    // Records at or above the severity are kept in memory and can be queried by event.
+    // Off by default. Only the last maxRecords records are kept, the counts are exact
+    static void enableStore(Severity severity, int maxRecords);
+    static QVector<Record> records(Event event);
+    // Stored records of the event since clearRecords(), including the ones no longer kept
+    static int recordCount(Event event);
+    static void clearRecords();
+
+    static bool isEnabled(Severity severity);
+
+    template<typename... Args>
+    static void log(Severity severity, Event event, const Args&... args)
+    {
+        if (!isEnabled(severity))
+        {
+            return;
+        }
+
+        write(Record{ severity, event, QVariantList{ QVariant(args)... } });
+    }
+
+    // For messages that must be written later, after something else succeeded
+    template<typename... Args>
+    static void append(QVector<Record>& records, Severity severity, Event event, const Args&... args)
+    {
+        if (!isEnabled(severity))
+        {
+            return;
+        }
+
+        records.append(Record{ severity, event, QVariantList{ QVariant(args)... } });
+    }
+
+    static void write(const Record& record);
+
+    static QString eventName(Event event);
+    static QString severityName(Severity severity);
+
+private:
+    static void updateMinSeverity();
+};
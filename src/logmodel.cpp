@@ -0,0 +1,307 @@
+#include "logmodel.h"
+#include <QByteArrayMatcher>
+#include <QBrush>
+#include <QColor>
+#include <QTimer>
+#include <algorithm>
+
+namespace
+{
+
+static const int ChunkBytes = 1024 * 1024;
+
+}
+
+LogModel::LogModel(QObject *parent)
+    : QAbstractListModel(parent)
+{
+    offsets.append(0);
+}
+
+int LogModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+    {
+        return 0;
+    }
+
+    return visibleCount;
+}
+
+QVariant LogModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= visibleCount)
+    {
+        return QVariant();
+    }
+
+    const int line = filtered ? visible.at(index.row()) : index.row();
+
+    switch (role)
+    {
+    case Qt::DisplayRole:
+        return QString::fromUtf8(lineText(line));
+
+    case Qt::ForegroundRole:
+        switch (static_cast<Logger::Severity>(severities.at(line)))
+        {
+        case Logger::Severity::Warning:
+            return QBrush(QColor(176, 112, 0));
+        case Logger::Severity::Error:
+            return QBrush(Qt::red);
+        default:
+            return QVariant();
+        }
+
+    default:
+        return QVariant();
+    }
+}
+
+void LogModel::append(Logger::Severity severity, Logger::Event event, const QString &lineText)
+{
+    const QByteArray utf8 = lineText.toUtf8();
+
+    if (chunks.isEmpty() || (!chunks.last().isEmpty() && chunks.last().size() + utf8.size() > ChunkBytes))
+    {
+        chunkStarts.append(offsets.last());
+        chunks.append(QByteArray());
+        chunks.last().reserve(std::max(ChunkBytes, utf8.size()));
+    }
+
+    chunks.last() += utf8;
+
+    offsets.append(offsets.last() + utf8.size());
+    severities.append(static_cast<quint8>(severity));
+    events.append(static_cast<quint8>(event));
+
+    const int line = severities.count() - 1;
+
+    if (filtered)
+    {
+        if (!isAccepted(line, filter))
+        {
+            return;
+        }
+
+        visible.append(line);
+    }
+
+    pendingCount++;
+    scheduleFlush();
+}
+
+void LogModel::clear()
+{
+    beginResetModel();
+
+    chunks.clear();
+    chunkStarts.clear();
+    offsets.clear();
+    offsets.append(0);
+    severities.clear();
+    events.clear();
+    visible.clear();
+    visibleCount = 0;
+    pendingCount = 0;
+
+    endResetModel();
+}
+
+void LogModel::setFilter(Logger::Severity minSeverity, int event, const QString &search)
+{
+    Filter newFilter;
+    newFilter.minSeverity = minSeverity;
+    newFilter.event = event;
+    newFilter.search = search.toLower().toUtf8();
+
+    const bool newFiltered = newFilter.minSeverity != Logger::Severity::Debug || newFilter.event >= 0 || !newFilter.search.isEmpty();
+
+    QVector<int> newVisible;
+
+    if (newFiltered)
+    {
+        const bool narrowing = filtered
+                && newFilter.minSeverity >= filter.minSeverity
+                && (filter.event < 0 || newFilter.event == filter.event)
+                && newFilter.search.contains(filter.search);
+
+        if (narrowing)
+        {
+            // Typing more characters only removes rows, so only the current rows are checked
+            newVisible.reserve(visible.count());
+            for (int line : visible)
+            {
+                if (isAccepted(line, newFilter))
+                {
+                    newVisible.append(line);
+                }
+            }
+        }
+        else
+        {
+            newVisible = findAll(newFilter);
+        }
+    }
+
+    beginResetModel();
+
+    filter = newFilter;
+    filtered = newFiltered;
+    visible = newVisible;
+    visibleCount = filtered ? visible.count() : lineCount();
+    pendingCount = 0;
+
+    endResetModel();
+}
+
+QByteArray LogModel::lineText(int line) const
+{
+    const qint64 begin = offsets.at(line);
+    const int size = int(offsets.at(line + 1) - begin);
+    if (size == 0)
+    {
+        return QByteArray();
+    }
+
+    const int chunk = int(std::upper_bound(chunkStarts.constBegin(), chunkStarts.constEnd(), begin) - chunkStarts.constBegin()) - 1;
+
+    return chunks.at(chunk).mid(int(begin - chunkStarts.at(chunk)), size);
+}
+
+QByteArray LogModel::toLowerUtf8(const QByteArray &utf8)
+{
+    return QString::fromUtf8(utf8).toLower().toUtf8();
+}
+
+bool LogModel::isAccepted(int line, const Filter &lineFilter) const
+{
+    if (!isAcceptedIgnoringSearch(line, lineFilter))
+    {
+        return false;
+    }
+
+    if (lineFilter.search.isEmpty())
+    {
+        return true;
+    }
+
+    return toLowerUtf8(lineText(line)).contains(lineFilter.search);
+}
+
+bool LogModel::isAcceptedIgnoringSearch(int line, const Filter &lineFilter) const
+{
+    if (severities.at(line) < static_cast<quint8>(lineFilter.minSeverity))
+    {
+        return false;
+    }
+
+    if (lineFilter.event >= 0 && events.at(line) != lineFilter.event)
+    {
+        return false;
+    }
+
+    return true;
+}
+
+QVector<int> LogModel::findAll(const Filter &lineFilter) const
+{
+    QVector<int> result;
+
+    if (lineFilter.search.isEmpty())
+    {
+        for (int line = 0; line < lineCount(); ++line)
+        {
+            if (isAcceptedIgnoringSearch(line, lineFilter))
+            {
+                result.append(line);
+            }
+        }
+
+        return result;
+    }
+
+    // One pass over each chunk lowered as a whole, each match is mapped to its line with a binary search
+    const QByteArrayMatcher matcher(lineFilter.search);
+
+    for (int chunk = 0; chunk < chunks.count(); ++chunk)
+    {
+        const qint64 chunkStart = chunkStarts.at(chunk);
+        const qint64 chunkEnd = chunkStart + chunks.at(chunk).size();
+
+        const int firstLine = int(std::lower_bound(offsets.constBegin(), offsets.constEnd() - 1, chunkStart) - offsets.constBegin());
+        const int endLine = int(std::lower_bound(offsets.constBegin() + firstLine, offsets.constEnd() - 1, chunkEnd) - offsets.constBegin());
+
+        const QByteArray lowerChunk = toLowerUtf8(chunks.at(chunk));
+
+        if (lowerChunk.size() != chunks.at(chunk).size())
+        {
+            // Some letters take a different number of bytes in lower case, positions do not match the lines
+            for (int line = firstLine; line < endLine; ++line)
+            {
+                if (isAccepted(line, lineFilter))
+                {
+                    result.append(line);
+                }
+            }
+
+            continue;
+        }
+
+        int from = 0;
+        while (true)
+        {
+            const int position = matcher.indexIn(lowerChunk, from);
+            if (position == -1)
+            {
+                break;
+            }
+
+            const qint64 offset = chunkStart + position;
+            const int line = int(std::upper_bound(offsets.constBegin() + firstLine, offsets.constBegin() + endLine, offset) - offsets.constBegin()) - 1;
+
+            // A match across two lines does not count
+            if (offset + lineFilter.search.size() <= offsets.at(line + 1) && isAcceptedIgnoringSearch(line, lineFilter))
+            {
+                result.append(line);
+                from = int(offsets.at(line + 1) - chunkStart);
+            }
+            else
+            {
+                from = position + 1;
+            }
+        }
+    }
+
+    return result;
+}
+
+void LogModel::scheduleFlush()
+{
+    if (flushScheduled)
+    {
+        return;
+    }
+
+    flushScheduled = true;
+
+    QTimer::singleShot(0, this, [this]()
+    {
+        flush();
+    });
+}
+
+void LogModel::flush()
+{
+    flushScheduled = false;
+
+    if (pendingCount == 0)
+    {
+        return;
+    }
+
+    beginInsertRows(QModelIndex(), visibleCount, visibleCount + pendingCount - 1);
+    visibleCount += pendingCount;
+    pendingCount = 0;
+    endInsertRows();
+}
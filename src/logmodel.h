@@ -0,0 +1,57 @@
+#pragma once
+
+#include "logger.h"
+#include <QAbstractListModel>
+#include <QByteArray>
+#include <QVector>
+
+// Append-only log lines for a list view. The text of all lines is kept in UTF-8 chunks,
+// only the rows that pass the filters are visible
+class LogModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    explicit LogModel(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    void append(Logger::Severity severity, Logger::Event event, const QString& text);
+    void clear();
+    int lineCount() const { return severities.count(); }
+
+    // event < 0 - any event. Search is case insensitive
+    void setFilter(Logger::Severity minSeverity, int event, const QString& search);
+
+private:
+    struct Filter
+    {
+        Logger::Severity minSeverity = Logger::Severity::Debug;
+        int event = -1;
+        QByteArray search; // lower case UTF-8
+    };
+
+    QByteArray lineText(int line) const;
+    static QByteArray toLowerUtf8(const QByteArray& utf8);
+
+    bool isAccepted(int line, const Filter& lineFilter) const;
+    bool isAcceptedIgnoringSearch(int line, const Filter& lineFilter) const;
+    QVector<int> findAll(const Filter& lineFilter) const;
+    void scheduleFlush();
+    void flush();
+
+    // A line never spans two chunks. Search lowers one chunk at a time, no lower case copy is kept
+    QVector<QByteArray> chunks;
+    QVector<qint64> chunkStarts; // offset of the first byte of each chunk
+    QVector<qint64> offsets; // start of each line, plus the end of the last line
+    QVector<quint8> severities;
+    QVector<quint8> events;
+
+    Filter filter;
+    bool filtered = false;
+    QVector<int> visible; // lines that pass the filter, when filtered
+    int visibleCount = 0; // rows already reported to the view
+    int pendingCount = 0; // rows appended but not reported to the view yet
+    bool flushScheduled = false;
+};
@@ -1,9 +1,11 @@
 #include "logwindow.h"
 #include "ui_logwindow.h"
+#include "logmodel.h"
 
 LogWindow::LogWindow(QWidget *parent) :
     QDialog(parent),
-    ui(new Ui::LogWindow)
+    ui(new Ui::LogWindow),
+    model(new LogModel(this))
 {
     ui->setupUi(this);
 
@@ -12,6 +14,28 @@ LogWindow::LogWindow(QWidget *parent) :
                    | Qt::WindowMinimizeButtonHint
                    | Qt::WindowMaximizeButtonHint
                    | Qt::WindowCloseButtonHint);
+
+    ui->listViewLog->setModel(model);
+
+    for (Logger::Severity severity : { Logger::Severity::Debug, Logger::Severity::Info, Logger::Severity::Warning, Logger::Severity::Error })
+    {
+        ui->comboBoxSeverity->addItem(Logger::severityName(severity), static_cast<int>(severity));
+    }
+
+    ui->comboBoxCategory->addItem(tr("All"), -1);
+    for (int event = 0; event < static_cast<int>(Logger::Event::Count); ++event)
+    {
+        ui->comboBoxCategory->addItem(Logger::eventName(static_cast<Logger::Event>(event)), event);
+    }
+
+    connect(ui->comboBoxSeverity, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &LogWindow::updateFilter);
+    connect(ui->comboBoxCategory, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &LogWindow::updateFilter);
+    connect(ui->lineEditSearch, &QLineEdit::textChanged, this, &LogWindow::updateFilter);
+
+    connect(model, &LogModel::rowsInserted, this, &LogWindow::updateCount);
+    connect(model, &LogModel::modelReset, this, &LogWindow::updateCount);
+
+    updateCount();
 }
 
 LogWindow::~LogWindow()
@@ -21,17 +45,22 @@ LogWindow::~LogWindow()
 
 void LogWindow::clear()
 {
-    ui->textBrowserLog->setText(QString());
+    model->clear();
 }
 
 void LogWindow::addLine(const QString &line)
 {
-    ui->textBrowserLog->append(line);
+    model->append(Logger::Severity::Info, Logger::Event::Message, line);
+}
+
+void LogWindow::addRecord(const Logger::Record &record)
+{
+    model->append(record.severity, record.event, record.toString());
 }
 
 bool LogWindow::isEmpty() const
 {
-    return ui->textBrowserLog->toPlainText().isEmpty();
+    return model->lineCount() == 0;
 }
 
 void LogWindow::on_pushButtonOk_clicked()
@@ -39,3 +68,14 @@ void LogWindow::on_pushButtonOk_clicked()
     close();
 }
 
+void LogWindow::updateFilter()
+{
+    model->setFilter(static_cast<Logger::Severity>(ui->comboBoxSeverity->currentData().toInt()),
+                     ui->comboBoxCategory->currentData().toInt(),
+                     ui->lineEditSearch->text());
+}
+
+void LogWindow::updateCount()
+{
+    ui->labelCount->setText(tr("%1 of %2 lines").arg(model->rowCount()).arg(model->lineCount()));
+}
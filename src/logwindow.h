@@ -1,8 +1,11 @@
 #ifndef LOGWINDOW_H
 #define LOGWINDOW_H
 
+#include "logger.h"
 #include <QDialog>
 
+class LogModel;
+
 namespace Ui {
 class LogWindow;
 }
@@ -16,13 +19,17 @@ public:
     ~LogWindow();
     void clear();
     void addLine(const QString& line);
+    void addRecord(const Logger::Record& record);
     bool isEmpty() const;
 
 private slots:
     void on_pushButtonOk_clicked();
+    void updateFilter();
+    void updateCount();
 
 private:
     Ui::LogWindow *ui;
+    LogModel* model = nullptr;
 };
 
 #endif // LOGWINDOW_H
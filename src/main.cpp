@@ -1,13 +1,163 @@
 #include "mainwindow.h"
+#include "batchconverter.h"
+#include "gmksplitcache.h"
+#include "gms1corrector.h"
+#include "fileutils.h"
+#include "logger.h"
+#include "snapshot.h"
 
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QJsonDocument>
+#include <QTextStream>
+
+namespace
+{
+
+bool isConsoleMode(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        if (qstrcmp(argv[i], "--batch") == 0 || qstrcmp(argv[i], "--restore") == 0)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+int runConsole(const QStringList& arguments)
+{
+    QTextStream out(stdout);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addVersionOption();
+
+    const QCommandLineOption batchOption("batch", "Convert all projects listed in the JSON <manifest>.", "manifest");
+    const QCommandLineOption threadsOption("threads", "Maximum number of worker threads, 0 - number of CPU cores.", "count", "0");
+    const QCommandLineOption ioLimitOption("io-limit", "Maximum number of concurrent file operations, 0 - unlimited.", "count", "0");
+    const QCommandLineOption summaryOption("summary", "Save the per-project result summary as JSON to <file>.", "file");
+    const QCommandLineOption splitCacheOption("split-cache-size", "Maximum size of the gmksplit output cache in megabytes, 0 - disabled.", "megabytes");
+    const QCommandLineOption roomMemoryOption("room-memory-cap", "Rooms that would need more memory are corrected by streaming, in megabytes, 0 - never stream.", "megabytes");
+    const QCommandLineOption splitWorkerOption("split-worker-threads", "Threads of the gmksplit.jar worker shared by the batch, 0 - run gmksplit for every GMK.", "count", "1");
+    const QCommandLineOption auditOption("audit", "Only compare GMK and GMS1 of the projects and report the differences, nothing is modified.");
+    const QCommandLineOption reportOption("report", "Save the audit report as JSON to <file> instead of printing it.", "file");
+    const QCommandLineOption noSnapshotOption("no-snapshot", "Do not keep the original state of the changed files.");
+    const QCommandLineOption restoreOption("restore", "Put back the files saved in the <snapshot> folder and exit.", "snapshot");
+    const QCommandLineOption logLevelOption("log-level", "Lowest severity written to stderr: debug, info, warning or error.", "level", "warning");
+
+    parser.addOptions({ batchOption, threadsOption, ioLimitOption, summaryOption, splitCacheOption, roomMemoryOption, splitWorkerOption, auditOption, reportOption, noSnapshotOption, restoreOption, logLevelOption });
+    parser.process(arguments);
+
+    const QString logLevel = parser.value(logLevelOption).toLower();
+    Logger::Severity logSeverity = Logger::Severity::Warning;
+    if (logLevel == "debug")
+    {
+        logSeverity = Logger::Severity::Debug;
+    }
+    else if (logLevel == "info")
+    {
+        logSeverity = Logger::Severity::Info;
+    }
+    else if (logLevel == "error")
+    {
+        logSeverity = Logger::Severity::Error;
+    }
+
+    Logger::addSink(logSeverity, [](const Logger::Record& record)
+    {
+        qDebug("%s", record.toString().toUtf8().constData());
+    });
+
+    if (parser.isSet(restoreOption))
+    {
+        return Snapshot::restore(parser.value(restoreOption)) ? 0 : 1;
+    }
+
+    if (parser.isSet(splitCacheOption))
+    {
+        GmkSplitCache::setMaxSize(parser.value(splitCacheOption).toLongLong() * 1024 * 1024);
+    }
+
+    if (parser.isSet(roomMemoryOption))
+    {
+        GMS1Corrector::setRoomMemoryCap(parser.value(roomMemoryOption).toLongLong() * 1024 * 1024);
+    }
+
+    QString error;
+    const QVector<BatchConverter::Project> projects = BatchConverter::loadManifest(parser.value(batchOption), error);
+    if (projects.isEmpty())
+    {
+        out << error << Qt::endl;
+        return 1;
+    }
+
+    BatchConverter converter;
+    converter.setMaxThreadCount(parser.value(threadsOption).toInt());
+    converter.setMaxConcurrentIo(parser.value(ioLimitOption).toInt());
+    converter.setSplitWorkerThreads(parser.value(splitWorkerOption).toInt());
+    converter.setSnapshotsEnabled(!parser.isSet(noSnapshotOption));
+
+    if (parser.isSet(auditOption))
+    {
+        const QJsonObject report = converter.audit(projects);
+
+        if (parser.isSet(reportOption))
+        {
+            if (!BatchConverter::saveReport(parser.value(reportOption), report))
+            {
+                out << QString("Failed to save report to \"%1\"").arg(parser.value(reportOption)) << Qt::endl;
+                return 1;
+            }
+        }
+        else
+        {
+            out << QJsonDocument(report).toJson();
+        }
+
+        return BatchConverter::hasDivergences(report) ? 2 : 0;
+    }
+
+    const QVector<BatchConverter::ProjectResult> results = converter.run(projects);
+
+    out << BatchConverter::summary(results);
+
+    if (parser.isSet(summaryOption) && !BatchConverter::saveSummary(parser.value(summaryOption), results))
+    {
+        out << QString("Failed to save summary to \"%1\"").arg(parser.value(summaryOption)) << Qt::endl;
+    }
+
+    for (const BatchConverter::ProjectResult& result : results)
+    {
+        if (!result.prepared || result.failed > 0)
+        {
+            return 2;
+        }
+    }
+
+    return 0;
+}
+
+}
 
 int main(int argc, char *argv[])
 {
     QApplication::setApplicationVersion("0.1");
 
+    if (isConsoleMode(argc, argv))
+    {
+        QCoreApplication a(argc, argv);
+        const int result = runConsole(a.arguments());
+        FileUtils::waitForBackgroundRemovals();
+        return result;
+    }
+
     QApplication a(argc, argv);
     MainWindow w;
     w.show();
-    return a.exec();
+    const int result = a.exec();
+    FileUtils::waitForBackgroundRemovals();
+    return result;
 }
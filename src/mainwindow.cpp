@@ -2,7 +2,10 @@
 #include "ui_mainwindow.h"
 #include "gms1corrector.h"
 #include "gms2corrector.h"
+#include "logger.h"
+#include "snapshot.h"
 #include <QFileDialog>
+#include <QThread>
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
@@ -12,19 +15,23 @@ MainWindow::MainWindow(QWidget *parent)
 
     setWindowTitle(QApplication::applicationName() + " v" + QApplication::applicationVersion());
 
-    GMS1Corrector::setLogCallback([this](const QString& text)
+    logSinkId = Logger::addSink(Logger::Severity::Info, [this](const Logger::Record& record)
     {
-        log->addLine(text);
-    });
-
-    GMS2Corrector::setLogCallback([this](const QString& text)
-    {
-        log->addLine(text);
+        if (QThread::currentThread() == log->thread())
+        {
+            log->addRecord(record);
+        }
+        else
+        {
+            QMetaObject::invokeMethod(log, [this, record]() { log->addRecord(record); }, Qt::QueuedConnection);
+        }
     });
 }
 
 MainWindow::~MainWindow()
 {
+    Logger::removeSink(logSinkId);
+
     delete ui;
 }
 
@@ -64,7 +71,12 @@ void MainWindow::on_pushButtonFindGMS2Folder_clicked()
 void MainWindow::on_pushButtonBreakToExitCorrect_clicked()
 {
     log->clear();
-    GMS2Corrector::breakToExit(ui->lineEditGMS2Folder->text());
+
+    {
+        const Snapshot::Scope snapshot(ui->lineEditGMS2Folder->text());
+        GMS2Corrector::breakToExit(ui->lineEditGMS2Folder->text());
+    }
+
     log->show();
 }
 
@@ -72,6 +84,8 @@ void MainWindow::on_pushButtonCorrectFunctions_clicked()
 {
     log->clear();
 
+    const Snapshot::Scope snapshot(ui->lineEditGMS2Folder->text());
+
     if (ui->checkBoxWindowCaption->isChecked())
     {
         GMS2Corrector::replace(ui->lineEditGMS2Folder->text(), "window_set_taskbar_caption(", "window_set_caption(");
@@ -103,7 +117,19 @@ void MainWindow::on_pushButtonCorrectFunctions_clicked()
 void MainWindow::on_pushButtonCorrectTextEncoding_clicked()
 {
     log->clear();
-    GMS1Corrector::convertAnsiToUtf8(ui->lineEditGMKFile->text(), ui->lineEditGMS1Folder->text());
+
+    // Without a GMS1 project the GMS2 project is corrected straight from the GMK
+    if (ui->lineEditGMS1Folder->text().isEmpty() && !ui->lineEditGMS2Folder->text().isEmpty())
+    {
+        const Snapshot::Scope snapshot(ui->lineEditGMS2Folder->text());
+        GMS2Corrector::convertAnsiToUtf8(ui->lineEditGMKFile->text(), ui->lineEditGMS2Folder->text());
+    }
+    else
+    {
+        const Snapshot::Scope snapshot(ui->lineEditGMS1Folder->text());
+        GMS1Corrector::convertAnsiToUtf8(ui->lineEditGMKFile->text(), ui->lineEditGMS1Folder->text());
+    }
+
     log->show();
 }
 
@@ -32,5 +32,6 @@ private slots:
 private:
     Ui::MainWindow *ui;
     LogWindow* log = new LogWindow(this);
+    int logSinkId = -1;
 };
 #endif // MAINWINDOW_H
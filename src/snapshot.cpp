@@ -0,0 +1,376 @@
+#include "snapshot.h"
+#include "fileutils.h"
+#include "logger.h"
+#include <QAtomicInt>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMap>
+#include <QMutex>
+#include <QSaveFile>
+#include <QWaitCondition>
+#include <memory>
+
+namespace
+{
+
+using Severity = Logger::Severity;
+using Event = Logger::Event;
+
+static const QString ManifestFileName = "manifest.json";
+static const QString FilesFolderName = "files";
+static const QString CompressedSuffix = ".qz";
+
+static const QString PendingMode = "pending"; // being copied, never written to the manifest
+static const QString ReflinkMode = "reflink";
+static const QString CompressedMode = "compressed";
+static const QString AbsentMode = "absent"; // created by the run, removed on restore
+
+struct State
+{
+    QString root;
+    QString folder;
+    int users = 0;
+
+    QMutex mutex;
+    QWaitCondition copied; // a pending entry got its mode or was removed
+    int pending = 0;
+    QMap<QString, QString> files; // relative path - mode
+};
+
+static QMutex registryMutex;
+static QMap<QString, std::shared_ptr<State>> states;
+
+// Checked without locking, so writes outside of snapshots cost nothing
+static QAtomicInt activeCount = 0;
+
+QString cleanAbsolutePath(const QString& path)
+{
+    return QDir::cleanPath(QFileInfo(path).absoluteFilePath());
+}
+
+bool writeCompressed(const QString& fileName, const QString& archiveName)
+{
+    QFile file(fileName);
+    if (!file.open(QFile::ReadOnly))
+    {
+        return false;
+    }
+
+    QSaveFile archive(archiveName);
+    if (!archive.open(QFile::WriteOnly))
+    {
+        return false;
+    }
+
+    archive.write(qCompress(file.readAll()));
+
+    return archive.commit();
+}
+
+bool writeUncompressed(const QString& archiveName, const QString& fileName)
+{
+    QFile archive(archiveName);
+    if (!archive.open(QFile::ReadOnly))
+    {
+        return false;
+    }
+
+    const QByteArray data = qUncompress(archive.readAll());
+    if (data.isNull())
+    {
+        return false;
+    }
+
+    QSaveFile file(fileName);
+    if (!file.open(QFile::WriteOnly))
+    {
+        return false;
+    }
+
+    file.write(data);
+
+    return file.commit();
+}
+
+}
+
+QString Snapshot::begin(const QString &projectFolder)
+{
+    const QString root = cleanAbsolutePath(projectFolder);
+
+    QMutexLocker locker(&registryMutex);
+
+    std::shared_ptr<State>& state = states[root];
+    if (!state)
+    {
+        const QFileInfo rootInfo(root);
+
+        state = std::make_shared<State>();
+        state->root = root;
+        state->folder = rootInfo.absolutePath() + "/." + rootInfo.fileName() + ".snapshots/"
+                + QDateTime::currentDateTime().toString("yyyyMMdd-HHmmss-zzz");
+
+        activeCount.ref();
+    }
+
+    state->users++;
+
+    return state->folder;
+}
+
+bool Snapshot::end(const QString &projectFolder)
+{
+    const QString root = cleanAbsolutePath(projectFolder);
+
+    std::shared_ptr<State> state;
+
+    {
+        QMutexLocker locker(&registryMutex);
+
+        const auto it = states.find(root);
+        if (it == states.end() || --it.value()->users > 0)
+        {
+            return false;
+        }
+
+        state = it.value();
+        states.erase(it);
+
+        activeCount.deref();
+    }
+
+    QMutexLocker locker(&state->mutex);
+
+    while (state->pending > 0)
+    {
+        state->copied.wait(&state->mutex);
+    }
+
+    if (state->files.isEmpty())
+    {
+        return false;
+    }
+
+    QJsonArray files;
+    for (auto it = state->files.constBegin(); it != state->files.constEnd(); ++it)
+    {
+        QJsonObject file;
+        file.insert("path", it.key());
+        file.insert("mode", it.value());
+        files.append(file);
+    }
+
+    QJsonObject manifest;
+    manifest.insert("project", state->root);
+    manifest.insert("created", QDateTime::currentDateTime().toString(Qt::ISODate));
+    manifest.insert("files", files);
+
+    const QString manifestFileName = state->folder + "/" + ManifestFileName;
+
+    // Only files created by the run, nothing was copied and the folder does not exist yet
+    QDir().mkpath(state->folder);
+
+    QSaveFile manifestFile(manifestFileName);
+    if (!manifestFile.open(QFile::WriteOnly))
+    {
+        Logger::log(Severity::Error, Event::FileWriteFailed, manifestFileName);
+        return false;
+    }
+
+    manifestFile.write(QJsonDocument(manifest).toJson());
+
+    if (!manifestFile.commit())
+    {
+        Logger::log(Severity::Error, Event::FileWriteFailed, manifestFileName);
+        return false;
+    }
+
+    Logger::log(Severity::Info, Event::SnapshotSaved, state->folder, state->files.count());
+
+    return true;
+}
+
+void Snapshot::preserve(const QString &fileName)
+{
+    if (activeCount.loadRelaxed() == 0)
+    {
+        return;
+    }
+
+    const QString path = cleanAbsolutePath(fileName);
+
+    std::shared_ptr<State> state;
+
+    {
+        QMutexLocker locker(&registryMutex);
+
+        for (const std::shared_ptr<State>& candidate : states)
+        {
+            if (path.startsWith(candidate->root + "/"))
+            {
+                state = candidate;
+                break;
+            }
+        }
+    }
+
+    if (!state)
+    {
+        return;
+    }
+
+    const QString relativePath = path.mid(state->root.length() + 1);
+
+    {
+        QMutexLocker locker(&state->mutex);
+
+        // Another thread copying the same file, it is changed only once the copy is done
+        while (state->files.value(relativePath) == PendingMode)
+        {
+            state->copied.wait(&state->mutex);
+        }
+
+        // Only the state before the first change counts
+        if (state->files.contains(relativePath))
+        {
+            return;
+        }
+
+        // Reserved, so the copy is made without the lock and other files of the project are not held up
+        state->files.insert(relativePath, PendingMode);
+        state->pending++;
+    }
+
+    QString mode;
+
+    if (!QFileInfo::exists(path))
+    {
+        mode = AbsentMode;
+    }
+    else
+    {
+        const QString copyName = state->folder + "/" + FilesFolderName + "/" + relativePath;
+
+        if (QDir().mkpath(QFileInfo(copyName).absolutePath()))
+        {
+            if (FileUtils::cloneFile(path, copyName))
+            {
+                mode = ReflinkMode;
+            }
+            else if (writeCompressed(path, copyName + CompressedSuffix))
+            {
+                mode = CompressedMode;
+            }
+        }
+    }
+
+    if (mode.isEmpty())
+    {
+        Logger::log(Severity::Error, Event::SnapshotFailed, path);
+    }
+
+    QMutexLocker locker(&state->mutex);
+
+    if (mode.isEmpty())
+    {
+        state->files.remove(relativePath);
+    }
+    else
+    {
+        state->files.insert(relativePath, mode);
+    }
+
+    state->pending--;
+    state->copied.wakeAll();
+}
+
+bool Snapshot::restore(const QString &snapshotFolder)
+{
+    const QString manifestFileName = snapshotFolder + "/" + ManifestFileName;
+
+    QFile manifestFile(manifestFileName);
+    if (!manifestFile.open(QFile::ReadOnly))
+    {
+        Logger::log(Severity::Error, Event::FileReadFailed, manifestFileName);
+        return false;
+    }
+
+    QJsonParseError parseError;
+    const QJsonObject manifest = QJsonDocument::fromJson(manifestFile.readAll(), &parseError).object();
+    if (parseError.error != QJsonParseError::NoError)
+    {
+        Logger::log(Severity::Error, Event::JsonLoadFailed, manifestFileName, parseError.errorString());
+        return false;
+    }
+
+    const QString root = manifest.value("project").toString();
+    if (!QFileInfo(root).isDir())
+    {
+        Logger::log(Severity::Error, Event::FolderNotFound, root);
+        return false;
+    }
+
+    bool result = true;
+    int restored = 0;
+
+    for (const QJsonValue& value : manifest.value("files").toArray())
+    {
+        const QString relativePath = value.toObject().value("path").toString();
+        const QString mode = value.toObject().value("mode").toString();
+
+        const QString fileName = root + "/" + relativePath;
+        const QString copyName = snapshotFolder + "/" + FilesFolderName + "/" + relativePath;
+
+        bool ok = true;
+
+        if (mode == AbsentMode)
+        {
+            ok = !QFileInfo::exists(fileName) || QFile::remove(fileName);
+        }
+        else if (mode == CompressedMode)
+        {
+            ok = writeUncompressed(copyName + CompressedSuffix, fileName);
+        }
+        else
+        {
+            // Copied, not moved, the snapshot stays usable
+            ok = FileUtils::copyIfChanged(copyName, fileName) != FileUtils::Result::Failed;
+        }
+
+        if (!ok)
+        {
+            Logger::log(Severity::Error, Event::SnapshotRestoreFailed, fileName);
+            result = false;
+            continue;
+        }
+
+        restored++;
+    }
+
+    Logger::log(Severity::Info, Event::SnapshotRestored, snapshotFolder, restored);
+
+    return result;
+}
+
+Snapshot::Scope::Scope(const QString &projectFolder_)
+    : projectFolder(projectFolder_)
+{
+    if (!projectFolder.isEmpty())
+    {
+        snapshotFolder = begin(projectFolder);
+    }
+}
+
+Snapshot::Scope::~Scope()
+{
+    if (!projectFolder.isEmpty())
+    {
+        end(projectFolder);
+    }
+}
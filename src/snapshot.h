@@ -0,0 +1,37 @@
+#pragma once
+
+#include <QString>
+
+// Copies of the files a run changes, taken right before the first change of each file.
+// A reflink where the file system supports it, otherwise a qCompress'ed copy. Hard links are not used,
+// an in-place save by another tool would change the kept content too.
+// Snapshots are kept next to the project: <parent>/.<project>.snapshots/<time>
+class Snapshot
+{
+public:
+    // Starts a snapshot of the files changed under projectFolder, returns its folder
+    static QString begin(const QString& projectFolder);
+    // Saves the list of files. Returns false when nothing was saved, no file was changed
+    static bool end(const QString& projectFolder);
+
+    // Keeps the current state of the file if a snapshot covers it. Called before a file is replaced or created
+    static void preserve(const QString& fileName);
+
+    // Puts the files of the snapshot back into the project, files created by the run are removed
+    static bool restore(const QString& snapshotFolder);
+
+    // begin() and end() for the lifetime of the object
+    class Scope
+    {
+    public:
+        explicit Scope(const QString& projectFolder_);
+        ~Scope();
+
+        QString folder() const { return snapshotFolder; }
+
+    private:
+        Q_DISABLE_COPY(Scope)
+        QString projectFolder;
+        QString snapshotFolder;
+    };
+};
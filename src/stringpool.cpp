@@ -0,0 +1,45 @@
+#include "stringpool.h"
+
+int StringPool::intern(const QString &string)
+{
+    const auto it = ids.constFind(string);
+    if (it != ids.constEnd())
+    {
+        return it.value();
+    }
+
+    const int id = strings.count();
+    strings.append(string);
+    ids.insert(string, id);
+
+    return id;
+}
+
+int StringPool::find(const QString &string) const
+{
+    return ids.value(string, -1);
+}
+
+const QString &StringPool::string(int id) const
+{
+    static const QString Empty;
+
+    if (id < 0 || id >= strings.count())
+    {
+        return Empty;
+    }
+
+    return strings.at(id);
+}
+
+void StringPool::reserve(int size)
+{
+    ids.reserve(size);
+    strings.reserve(size);
+}
+
+void StringPool::clear()
+{
+    ids.clear();
+    strings.clear();
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+class StringPool
+{
+public:
+    int intern(const QString& string);
+    int find(const QString& string) const;
+    const QString& string(int id) const;
+    int count() const { return strings.count(); }
+    void reserve(int size);
+    void clear();
+
+private:
+    QHash<QString, int> ids;
+    QVector<QString> strings;
+};
@@ -0,0 +1,30 @@
+#include "workspace.h"
+#include "fileutils.h"
+
+Workspace::Workspace()
+{
+    dir.setAutoRemove(false);
+}
+
+Workspace::~Workspace()
+{
+    if (dir.isValid())
+    {
+        FileUtils::removeTreeInBackground(dir.path());
+    }
+}
+
+bool Workspace::isValid() const
+{
+    return dir.isValid();
+}
+
+QString Workspace::path() const
+{
+    return dir.path();
+}
+
+QString Workspace::filePath(const QString &fileName) const
+{
+    return dir.filePath(fileName);
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <QString>
+#include <QTemporaryDir>
+
+// Temp folder of one run, unique so that several runs can work at the same time.
+// On destruction it is removed in the background, the run does not wait for it
+class Workspace
+{
+public:
+    Workspace();
+    ~Workspace();
+
+    bool isValid() const;
+    QString path() const;
+    QString filePath(const QString& fileName) const;
+
+private:
+    Q_DISABLE_COPY(Workspace)
+    QTemporaryDir dir;
+};
@@ -0,0 +1,182 @@
+#include "yyjson.h"
+#include <vector>
+
+namespace
+{
+
+bool isSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// i is the position of the opening quote, returns the position after the closing quote
+int skipString(const QByteArray& data, int i)
+{
+    for (++i; i < data.size(); ++i)
+    {
+        if (data.at(i) == '\\')
+        {
+            ++i;
+        }
+        else if (data.at(i) == '"')
+        {
+            return i + 1;
+        }
+    }
+
+    return data.size();
+}
+
+}
+
+QJsonDocument YyJson::parse(const QByteArray &data, QJsonParseError *error)
+{
+    return QJsonDocument::fromJson(removeTrailingCommas(data), error);
+}
+
+QByteArray YyJson::removeTrailingCommas(const QByteArray &data)
+{
+    QByteArray result;
+    result.reserve(data.size());
+
+    int i = 0;
+    while (i < data.size())
+    {
+        const char c = data.at(i);
+
+        if (c == '"')
+        {
+            const int end = skipString(data, i);
+            result.append(data.constData() + i, end - i);
+            i = end;
+            continue;
+        }
+
+        if (c == ',')
+        {
+            int next = i + 1;
+            while (next < data.size() && isSpace(data.at(next)))
+            {
+                ++next;
+            }
+
+            if (next < data.size() && (data.at(next) == '}' || data.at(next) == ']'))
+            {
+                ++i;
+                continue;
+            }
+        }
+
+        result.append(c);
+        ++i;
+    }
+
+    return result;
+}
+
+bool YyJson::setValue(QByteArray &data, const QByteArray &objectName, const QByteArray &key, const QByteArray &jsonValue)
+{
+    struct Frame
+    {
+        bool isObject = false;
+        bool expectKey = true;
+        bool nameMatches = false;
+        QByteArray currentKey;
+        int valueBegin = -1;
+        int valueEnd = -1;
+    };
+
+    // One pass without building a document, only the open objects are kept
+    std::vector<Frame> stack;
+
+    int i = 0;
+    while (i < data.size())
+    {
+        const char c = data.at(i);
+
+        if (c == '{' || c == '[')
+        {
+            Frame frame;
+            frame.isObject = c == '{';
+            stack.push_back(frame);
+            ++i;
+            continue;
+        }
+
+        if (c == '}' || c == ']')
+        {
+            if (!stack.empty())
+            {
+                const Frame frame = stack.back();
+                stack.pop_back();
+
+                if (frame.isObject && frame.nameMatches && frame.valueBegin >= 0)
+                {
+                    data.replace(frame.valueBegin, frame.valueEnd - frame.valueBegin, jsonValue);
+                    return true;
+                }
+            }
+
+            ++i;
+            continue;
+        }
+
+        if (c == ',')
+        {
+            if (!stack.empty() && stack.back().isObject)
+            {
+                stack.back().expectKey = true;
+            }
+
+            ++i;
+            continue;
+        }
+
+        if (c == ':' || isSpace(c))
+        {
+            ++i;
+            continue;
+        }
+
+        int end = i;
+        if (c == '"')
+        {
+            end = skipString(data, i);
+        }
+        else
+        {
+            while (end < data.size() && !isSpace(data.at(end)) && data.at(end) != ',' && data.at(end) != '}' && data.at(end) != ']')
+            {
+                ++end;
+            }
+        }
+
+        if (!stack.empty() && stack.back().isObject)
+        {
+            Frame& frame = stack.back();
+
+            if (frame.expectKey)
+            {
+                frame.currentKey = data.mid(i + 1, end - i - 2);
+                frame.expectKey = false;
+            }
+            else
+            {
+                if (c == '"' && frame.currentKey == "name" && data.mid(i + 1, end - i - 2) == objectName)
+                {
+                    frame.nameMatches = true;
+                }
+
+                if (frame.currentKey == key)
+                {
+                    frame.valueBegin = i;
+                    frame.valueEnd = end;
+                }
+            }
+        }
+
+        i = end;
+    }
+
+    return false;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <QByteArray>
+#include <QJsonDocument>
+
+// GMS2 resource files (.yy). They are almost JSON, but GMS 2.3 writes trailing commas
+class YyJson
+{
+public:
+    static QJsonDocument parse(const QByteArray& data, QJsonParseError* error = nullptr);
+
+    // Replaces the value of key in the innermost object whose "name" is objectName.
+    // Only the bytes of the value change, the rest of the file keeps its formatting.
+    // The value must be a string, number, bool or null, jsonValue is written as is
+    static bool setValue(QByteArray& data, const QByteArray& objectName, const QByteArray& key, const QByteArray& jsonValue);
+
+private:
+    static QByteArray removeTrailingCommas(const QByteArray& data);
+};